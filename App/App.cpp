@@ -14,10 +14,13 @@
 
 // C
 #include <cstdio>
+#include <clocale>
 
 // C++
 #include <string>
 #include <vector>
+#include <sstream>
+#include <iostream>
 #include <filesystem>
 
 // Archive
@@ -43,12 +46,12 @@ public:
             wprintf(L"\r");
         } else if (ct == SCL::CLT_ARCHIVE_BEGIN) {
             // Output header
-            wprintf(L"\r  \u001b[4m\u001b[32m%7s"
-                     "\u001b[4m\u001b[31m%36s"
-                     "\u001b[0m\u001b[4m %15s %14s"
-                     "\u001b[0m\u001b[4m%12s"
-                     "\u001b[0m\u001b[4m%11s"
-                     "\u001b[4m\u001b[33m%12s"
+            wprintf(L"\r  \u001b[4m\u001b[32m%7ls"
+                     "\u001b[4m\u001b[31m%36ls"
+                     "\u001b[0m\u001b[4m %15ls %14ls"
+                     "\u001b[0m\u001b[4m%12ls"
+                     "\u001b[0m\u001b[4m%11ls"
+                     "\u001b[4m\u001b[33m%12ls"
                      "\u001b[0m\n\n",
                      L"%  ",
                      L"File",
@@ -66,7 +69,7 @@ public:
                 id  = info.file_ID;
 
                 wprintf(L"\r  \u001b[32;1m%4i%%   "
-                         "\u001b[31;1m%35.35ws"
+                         "\u001b[31;1m%35.35ls"
                          "\u001b[30;1m%10i kB"
                          "\u001b[0m"
                          " -> "
@@ -88,6 +91,8 @@ public:
             if (ct == SCL::CLT_FILE_FINISH) {
                 wprintf(L"\n");
             }
+        } else if (ct == SCL::CLT_FILE_CORRUPTED) {
+            wprintf(L"\n  \u001b[31;1mCorrupted data: %ls\u001b[0m\n", info.file_name.c_str());
         } else if (ct == SCL::CLT_ARCHIVE_FINISH) {
             wprintf(L"\n");
 
@@ -95,13 +100,13 @@ public:
             int decomp_size  = int(info.callback_action == SCL::CLA_COMPRESS ? info.archive_read_bytes : info.archive_written_bytes) / 1024 / 1024;
 
             // Summary
-            wprintf(L"    \u001b[30;1m%67s%40ws\n"
-                     "    \u001b[30;1m%67s%40ws\n"
-                     "    \u001b[30;1m%67s%40ws\n"
-                     "    \u001b[30;1m%67s%37i MB\n"
-                     "    \u001b[30;1m%67s%37i MB\n"
-                     "    \u001b[30;1m%67s%39i%%\n"
-                     "    \u001b[30;1m%67s%36i sec\n"
+            wprintf(L"    \u001b[30;1m%67ls%40ls\n"
+                     "    \u001b[30;1m%67ls%40ls\n"
+                     "    \u001b[30;1m%67ls%40ls\n"
+                     "    \u001b[30;1m%67ls%37i MB\n"
+                     "    \u001b[30;1m%67ls%37i MB\n"
+                     "    \u001b[30;1m%67ls%39i%%\n"
+                     "    \u001b[30;1m%67ls%36i sec\n"
                      "    \u001b[0m",
                      L"Archive path:", info.archive_path.c_str(),
                      L"Archive file:", info.archive_file.c_str(),
@@ -126,18 +131,19 @@ void printHeader() {
 
 // Usage info
 void printUsageInfo() {
-    wprintf(L"\u001b[31;1m\n  SCL.exe <input> \n\n"
+    wprintf(L"\u001b[31;1m\n  SCL.exe <input> [files]\n\n"
              "\u001b[30;1m"
              "  <input> - Program will automatically recognize whether the dropped file is an archive for decompression or\n"
              "            file/folder for compression. It will also prevent overwriting files by creating unique names for\n"
              "            outputed files and folders if needed.\n"
+             "  [files] - Names or wildcard patterns (*, ?) of files to extract from archive, all files if not given.\n"
              "\u001b[0m");
 }
 
 
 // Wait for input
 void waitForInput(const wchar_t * msg) {
-    wprintf(L"\n  Press enter to %s...\n\t", msg);
+    wprintf(L"\n  Press enter to %ls...\n\t", msg);
     cin.ignore();
 }
 
@@ -151,14 +157,14 @@ wstring suffixGen(int* i) {
 // Create unique name from given input name
 void createUniqueName(wstring& name, wstring* out, wchar_t const* next) {
     int suf(0);
-    path pn(name), base(name);
-    base.replace_extension(L"");
-    pn.replace_extension(next);
+    path pn = SCL::toPath(name), base = SCL::toPath(name);
+    base.replace_extension();
+    pn.replace_extension(SCL::toPath(next));
     while (exists(pn)) {
-        pn = wstring(wstring(base) + suffixGen(&suf));
-        pn.replace_extension(next);
+        pn = SCL::toPath(SCL::fromPath(base) + suffixGen(&suf));
+        pn.replace_extension(SCL::toPath(next));
     }
-    *out = pn;
+    *out = SCL::fromPath(pn);
 }
 
 // Main 
@@ -214,7 +220,9 @@ int wmain(int argc, wchar_t* argv[]) {
                 createUniqueName(first_arg, &decom_folder, L"");
                 // Wait
                 waitForInput(L"extract archive");
-                SCL.archiveExtract(archive, decom_folder);
+                // Names or patterns of files to extract follow archive name
+                files.erase(files.begin());
+                SCL.archiveExtract(archive, decom_folder, files);
 
                 break;
             case SCL::AD_UNKNOWN:
@@ -229,3 +237,15 @@ int wmain(int argc, wchar_t* argv[]) {
     waitForInput(L"quit");
     return 0;
 }
+
+#ifndef _WIN32
+// other systems pass arguments in locale encoding
+int main(int argc, char* argv[]) {
+    setlocale(LC_ALL, "");
+    vector<wstring>  args;
+    vector<wchar_t*> wargv;
+    for (int i = 0; i < argc; i++) args.push_back(SCL::fromPath(path(argv[i])));
+    for (wstring& arg : args) wargv.push_back(&arg[0]);
+    return wmain(argc, wargv.data());
+}
+#endif
@@ -82,12 +82,145 @@ CodecCallback::CodecCallback(ArchiveCallbackInterface* archive_callback) {
     this->total_bytes_to_process = 0;
 }
 
+// position of file in decompressed data of its job
+static QWord streamPos(FileInfo* file_info) {
+    return (file_info->file_header.flags & F_SOLID) ? file_info->file_header.file_solid_pos : 0;
+}
+
+// split writer
+SplitOutputStream::SplitOutputStream(vector<FileInfo*>& files, vector<Byte>& valid, wstring& extract_dir,
+                                     HashingInterface* hashing, atomic<QWord>* counter,
+                                     IOBackendInterface* io_backend, DWord batch_size)
+    : files(files), valid(valid), extract_dir(extract_dir) {
+    this->hashing    = hashing;
+    this->counter    = counter;
+    this->io_backend = io_backend;
+    this->batch_size = batch_size;
+    this->written = true;
+    this->current = 0;
+    this->started = false;
+}
+
+void SplitOutputStream::beginFile() {
+    hashing->init();
+    if (!extract_dir.empty()) {
+        QWord file_size = files[current]->file_header.file_size;
+        if (io_backend && file_size <= IO_BATCH_MAX_SIZE) {
+            batch_data.emplace_back();
+            batch_data.back().reserve(file_size);
+            batch_files.push_back(current);
+        } else {
+            wstring file_name = fromPath(toPath(extract_dir) / toPath(files[current]->relative_file_name));
+            written = ofile.create(file_name.c_str());
+        }
+    }
+    started = true;
+}
+
+void SplitOutputStream::finishFile(bool complete) {
+    if (ofile.isOpen()) {
+        FileMetadata metadata;
+        FileList::getMetadata(*files[current], metadata);
+        ofile.setMetadata(metadata);
+        ofile.close();
+    }
+    valid[current] = complete && written && hashing->getHash() == files[current]->file_header.file_hash;
+    written = true;
+    started = false;
+    current++;
+    if (batch_files.size() >= batch_size) writeBatch();
+}
+
+// file which could not be written is not valid
+void SplitOutputStream::writeBatch() {
+    if (batch_files.empty()) return;
+    vector<FileRequest>  batch;
+    vector<FileMetadata> metadata(batch_files.size());
+    for (QWord b = 0; b < batch_files.size(); b++) {
+        wstring file_name = fromPath(toPath(extract_dir) / toPath(files[batch_files[b]]->relative_file_name));
+        FileList::getMetadata(*files[batch_files[b]], metadata[b]);
+        batch.push_back({ file_name, batch_data[b].data(), batch_data[b].size(), 0, false, &metadata[b] });
+    }
+    io_backend->write(batch);
+    for (QWord b = 0; b < batch_files.size(); b++) {
+        if (!batch[b].ok) valid[batch_files[b]] = false;
+    }
+    batch_data.clear();
+    batch_files.clear();
+}
+
+bool SplitOutputStream::write(Byte* buf, QWord size) {
+    this->written_size = size;
+    while (current < files.size()) {
+        QWord begin = streamPos(files[current]);
+        QWord end   = begin + files[current]->file_header.file_size;
+
+        // data between selected files is dropped
+        if (this->pos < begin) {
+            QWord skip = min(size, begin - this->pos);
+            buf       += skip;
+            size      -= skip;
+            this->pos += skip;
+            if (this->pos < begin) break;
+        }
+        if (!started && this->pos > begin) {
+            finishFile(false);
+            continue;
+        }
+        if (!started) beginFile();
+
+        QWord part = min(size, end - this->pos);
+        hashing->updateHash(buf, part);
+        if (ofile.isOpen()) written = ofile.write(buf, part) && written;
+        else if (started && !batch_files.empty() && batch_files.back() == current) {
+            batch_data.back().insert(batch_data.back().end(), buf, buf + part);
+        }
+        *counter  += part;
+        buf       += part;
+        size      -= part;
+        this->pos += part;
+        if (this->pos < end) break;
+        finishFile(true);
+    }
+    this->pos += size;
+    this->size = this->pos;
+    return true;
+}
+
+void SplitOutputStream::finish() {
+    while (current < files.size()) {
+        // empty files at end of data are complete, others were cut by broken data
+        bool empty = !started && files[current]->file_header.file_size == 0 && streamPos(files[current]) <= this->pos;
+        if (!started) beginFile();
+        finishFile(empty);
+    }
+    writeBatch();
+}
+
 // constructor
 Archive::Archive() {
     codec               = new LZHuffman;
     hashing             = new Hashing;
     file_list           = new FileList;
     codec_callback      = nullptr;
+    archive_callback    = nullptr;
+    read_codecs         = nullptr;
+
+    // default settings
+    settings.block_checksum = true;
+    settings.compact_blocks = true;
+    settings.seek_table     = true;
+    settings.threads        = 0;
+    settings.spill_size     = 0x1000000;
+    settings.solid_size     = 0;
+    settings.solid_order    = SO_NAME;
+    settings.dedup          = true;
+    settings.hard_links     = false;
+    settings.chunk_dedup    = false;
+    settings.io_queue_depth = 0;
+    settings.pipeline_memory = 0x10000000;
+    settings.codec_policy    = selectCodec;
+    memset(&pipeline_stats, 0, sizeof(PipelineStats));
 }
 
 // descrutor
@@ -96,6 +229,7 @@ Archive::~Archive() {
     if (hashing)        delete hashing;
     if (codec_callback) delete codec_callback;
     if (file_list)      delete file_list;
+    archiveClose();
 }
 
 // callback
@@ -106,44 +240,999 @@ void Archive::setCallback(ArchiveCallbackInterface *archive_callback) {
     this->archive_callback = archive_callback;
 }
 
-// compress file
-bool Archive::compressFile(ifstream &ifile, ofstream &ofile, FileInfo& file_info) {
-    // callback
-    if (!archive_callback->callback(CLT_FILE_BEGIN)) return false;
+// settings
+ArchiveSettings* Archive::getSettings() {
+    return &this->settings;
+}
 
-    // hash -> compress
-    FileInputStream      icodec(&ifile);
-    FilePartOutputStream ocodec(&ofile, file_info.file_header.file_size);
-    hashing->init();
-    hashing->hashStream(&icodec);
-    file_info.file_header.file_hash            = hashing->getHash();
-    updateCallbackInfo(file_info);
-    file_info.file_header.file_compressed_size = codec->compressStream(&icodec, &ocodec);
-    
-    // final callback
-    if (!archive_callback->callback(CLT_FILE_FINISH)) return false;
-    return true;
+// statistics
+PipelineStats* Archive::getPipelineStats() {
+    return &this->pipeline_stats;
 }
 
-// decompress file
-bool Archive::decompressFile(ifstream &ifile, ofstream &ofile, FileInfo& file_info) {
-    if (!archive_callback->callback(CLT_FILE_BEGIN)) return false;
+// codec instance for file list (no progress callback)
+CodecInterface* Archive::createCodec() {
+    CodecInterface* worker_codec = new LZHuffman;
+    worker_codec->setBlockChecksum((archive_header.flags & AF_BLOCK_CHECKSUM) != 0);
+    worker_codec->setBlockFormat(getBlockFormat());
+    return worker_codec;
+}
 
-    // decompress -> hash
-    FilePartInputStream icodec(&ifile, file_info.file_header.file_compressed_size);
-    FileOutputStream    ocodec(&ofile);
-    HashingOutputStream hashing_ocodec(hashing, &ocodec);
-    hashing->init();
-    codec->decompressStream(&icodec, &hashing_ocodec);
+// codecs of files for worker threads (no progress callback)
+CodecSet* Archive::createCodecs() {
+    return new CodecSet((archive_header.flags & AF_BLOCK_CHECKSUM) != 0, getBlockFormat());
+}
 
-    // wrong hash
-    if (file_info.file_header.file_hash != hashing->getHash()) return false;
+// archives without compact blocks flag keep fixed block headers
+BlockFormat Archive::getBlockFormat() {
+    return (archive_header.flags & AF_COMPACT_BLOCKS) ? BF_COMPACT : BF_FIXED;
+}
+
+DWord Archive::getThreadCount() {
+    if (settings.threads > 0) return settings.threads;
+    DWord cores = thread::hardware_concurrency();
+    return cores > 0 ? cores : 1;
+}
+
+// compress file or solid group into memory or temporary file (worker thread)
+void Archive::compressJob(CompressJob& job, QWord job_index, CodecSet* worker_codecs, HashingInterface* worker_hashing,
+                          ChunkIndex& chunk_index, atomic<QWord>& read_bytes) {
+    vector<FileInfo>& list = *file_list->getFileList();
+    QWord compressed_size  = 0;
+    CodecInterface* worker_codec = worker_codecs->get(CodecChoice());
+
+    if (job.files.size() == 1) {
+        // streamed file is last of entries carried by job
+        FileInfo& file_info = job.entries.empty() ? list[job.files[0]] : job.entries.back();
+
+        // compressed data goes to memory or temporary file
+        ofstream spill_file;
+        if (!job.spill_name.empty()) spill_file.open(toPath(job.spill_name), ios::binary);
+        BufferOutputStream     buffer_output(&job.data);
+        FileOutputStream       spill_output(&spill_file);
+        OutputStreamInterface* output = job.spill_name.empty() ? (OutputStreamInterface*)&buffer_output : &spill_output;
+
+        if (settings.chunk_dedup && file_info.file_header.file_size > CHUNK_MAX_SIZE) {
+            compressed_size = compressChunks(file_info, job, job_index, output, worker_codec, worker_hashing, chunk_index, read_bytes);
+        } else {
+            // read -> hash -> count progress -> compress
+            ifstream            ifile;
+            if (!job.preload) ifile.open(toPath(file_info.absolute_file_name), ios::binary);
 
-    // final callback
-    if (!archive_callback->callback(CLT_FILE_FINISH)) return false;
+            // codec chosen by policy from name, size and windows of file
+            if (settings.codec_policy) {
+                Byte  sample[CODEC_SAMPLE_WINDOWS * CODEC_SAMPLE_SIZE];
+                QWord sample_size = 0;
+                QWord file_size   = job.preload ? job.input.size() : file_info.file_header.file_size;
+                for (DWord window = 0; window < CODEC_SAMPLE_WINDOWS; window++) {
+                    QWord pos = sampleWindowPos(file_size, window);
+                    if (pos >= file_size) break;
+                    QWord size = min(file_size - pos, CODEC_SAMPLE_SIZE);
+                    if (job.preload) {
+                        memcpy(sample + sample_size, job.input.data() + pos, size);
+                    } else {
+                        ifile.seekg(pos);
+                        ifile.read((char*)sample + sample_size, size);
+                        size = (QWord)ifile.gcount();
+                        ifile.clear();
+                    }
+                    sample_size += size;
+                }
+                if (!job.preload) ifile.seekg(0);
+                file_info.codec = settings.codec_policy(file_info.relative_file_name, file_info.file_header.file_size, sample, sample_size);
+                CodecInterface* file_codec = worker_codecs->get(file_info.codec);
+                if (file_codec) worker_codec = file_codec;
+                else            file_info.codec = CodecChoice();
+                if (!file_info.codec.isDefault()) file_info.file_header.flags |= F_CODEC;
+            }
+            FileInputStream     file_input(&ifile);
+            MemoryInputStream   loaded_input(job.input.data(), job.input.size());
+
+            // small file was read by input stage, large file is read ahead while its blocks are compressed
+            unique_ptr<PrefetchInputStream> prefetch_input;
+            if (!job.preload && file_info.file_header.file_size > PREFETCH_BLOCK_SIZE) prefetch_input.reset(new PrefetchInputStream(&file_input));
+            InputStreamInterface* source = job.preload ? &loaded_input : prefetch_input ? (InputStreamInterface*)prefetch_input.get() : &file_input;
+            HashingInputStream  hashing_input(worker_hashing, source);
+            CountingInputStream input(&hashing_input, &read_bytes);
+            worker_hashing->init();
+
+            // compressed data starts at 0, so seek table is already relative to file data
+            file_info.seek_table.clear();
+            if (settings.seek_table) worker_codec->setBlockIndex(&file_info.seek_table);
+            compressed_size = worker_codec->compressStream(&input, output);
+            worker_codec->setBlockIndex(nullptr);
+            file_info.file_header.file_hash = worker_hashing->getHash();
+
+            // seek table is useful only if file has more than one block
+            if (file_info.seek_table.size() > 1) file_info.file_header.flags |= F_SEEKTABLE;
+            else file_info.seek_table.clear();
+        }
+    } else {
+        // solid group - files are read one after another into one stream, unless input stage did it
+        vector<Byte> group;
+        if (job.preload) group.swap(job.input);
+        else             group.resize(job.input_size);
+        QWord solid_pos = 0;
+        for (QWord i : job.files) {
+            FileHeader& file_header = list[i].file_header;
+            if (!job.preload) {
+                ifstream ifile(toPath(list[i].absolute_file_name), ios::binary);
+                ifile.read((char*)group.data() + solid_pos, file_header.file_size);
+            }
+
+            worker_hashing->init();
+            worker_hashing->updateHash(group.data() + solid_pos, file_header.file_size);
+            file_header.file_hash      = worker_hashing->getHash();
+            file_header.file_solid_pos = solid_pos;
+            file_header.flags         |= F_SOLID;
+            list[i].seek_table.clear();
+            solid_pos  += file_header.file_size;
+            read_bytes += file_header.file_size;
+        }
+
+        MemoryInputStream  input(group.data(), group.size());
+        BufferOutputStream output(&job.data);
+        compressed_size = worker_codec->compressStream(&input, &output);
+    }
+
+    vector<Byte>().swap(job.input);
+
+    // all files of solid group share its compressed data
+    if (!job.entries.empty()) job.entries.back().file_header.file_compressed_size = compressed_size;
+    else for (QWord i : job.files) list[i].file_header.file_compressed_size = compressed_size;
+    job.compressed_size = compressed_size;
+}
+
+// cut file into content-defined chunks, compress only chunks not seen before in archive (worker thread)
+QWord Archive::compressChunks(FileInfo& file_info, CompressJob& job, QWord job_index, OutputStreamInterface* output,
+                              CodecInterface* worker_codec, HashingInterface* worker_hashing, ChunkIndex& chunk_index,
+                              atomic<QWord>& read_bytes) {
+    ifstream        ifile(toPath(file_info.absolute_file_name), ios::binary);
+    FileInputStream file_input(&ifile);
+    StrongHashing   strong_hashing;
+
+    // large file is read ahead while its chunks are compressed
+    unique_ptr<PrefetchInputStream> prefetch_input;
+    if (file_info.file_header.file_size > PREFETCH_BLOCK_SIZE) prefetch_input.reset(new PrefetchInputStream(&file_input));
+    InputStreamInterface* input = prefetch_input ? (InputStreamInterface*)prefetch_input.get() : &file_input;
+    vector<Byte>  buf(CHUNK_MAX_SIZE * 64);
+    QWord buf_begin = 0, buf_end = 0, in_pos = 0;
+    QWord begin_pos = output->getPos();
+    bool  eof = false;
+
+    worker_hashing->init();
+    file_info.chunk_list.clear();
+    file_info.seek_table.clear();
+    job.chunk_ids.clear();
+
+    while (true) {
+        // keep at least one maximal chunk in buffer
+        if (!eof && buf_end - buf_begin < CHUNK_MAX_SIZE) {
+            memmove(buf.data(), buf.data() + buf_begin, buf_end - buf_begin);
+            buf_end  -= buf_begin;
+            buf_begin = 0;
+            QWord free_size = buf.size() - buf_end;
+            input->read(buf.data() + buf_end, free_size);
+            QWord read_size = input->getReadSize();
+            worker_hashing->updateHash(buf.data() + buf_end, read_size);
+            read_bytes += read_size;
+            buf_end    += read_size;
+            if (read_size < free_size) eof = true;
+        }
+        if (buf_begin == buf_end) break;
+
+        Byte* chunk      = buf.data() + buf_begin;
+        QWord chunk_size = findChunkEnd(chunk, buf_end - buf_begin);
+        Byte  digest[STRONG_HASH_SIZE];
+        strong_hashing.init();
+        strong_hashing.updateHash(chunk, chunk_size);
+        strong_hashing.getHash(digest);
+
+        // first worker finding chunk stores it, its position is known when writer writes that job
+        QWord chunk_id;
+        bool  new_chunk;
+        {
+            lock_guard<mutex> lock(chunk_index.index_mutex);
+            auto found = chunk_index.ids.emplace(string((char*)digest, STRONG_HASH_SIZE), chunk_index.locations.size());
+            chunk_id  = found.first->second;
+            new_chunk = found.second;
+            if (new_chunk) chunk_index.locations.push_back({ job_index, 0, 0 });
+        }
+        if (new_chunk) {
+            QWord             out_pos = output->getPos() - begin_pos;
+            MemoryInputStream input(chunk, chunk_size);
+            QWord             chunk_compressed_size = worker_codec->compressStream(&input, output);
+
+            lock_guard<mutex> lock(chunk_index.index_mutex);
+            chunk_index.locations[chunk_id].out_pos         = out_pos;
+            chunk_index.locations[chunk_id].compressed_size = chunk_compressed_size;
+        }
+
+        file_info.chunk_list.push_back({ in_pos, 0, 0 });
+        job.chunk_ids.push_back(chunk_id);
+        in_pos    += chunk_size;
+        buf_begin += chunk_size;
+    }
+
+    file_info.file_header.file_hash = worker_hashing->getHash();
+    file_info.file_header.flags    |= F_CHUNKED;
+    return output->getPos() - begin_pos;
+}
+
+// append compressed file or solid group to archive (writer thread)
+bool Archive::writeCompressedJob(ofstream &archive_file, CompressJob& job) {
+    vector<FileInfo>& list = *file_list->getFileList();
+    QWord data_pos = archive_file.tellp();
+    for (QWord i : job.files) list[i].file_header.file_data_pos = data_pos;
+    job.data_pos = data_pos;
+
+    // duplicate refers to data of its original
+    for (auto& duplicate : job.duplicates) {
+        FileInfo& file_info = list[duplicate.first];
+        FileInfo& original  = list[duplicate.second];
+        file_info.file_header.file_data_pos        = original.file_header.file_data_pos;
+        file_info.file_header.file_compressed_size = original.file_header.file_compressed_size;
+        file_info.file_header.file_solid_pos       = original.file_header.file_solid_pos;
+        file_info.file_header.file_hash            = original.file_header.file_hash;
+        file_info.file_header.flags               |= (original.file_header.flags & (F_SOLID | F_SEEKTABLE | F_CHUNKED | F_CODEC)) | F_DUPLICATE;
+        file_info.seek_table                       = original.seek_table;
+        file_info.codec                            = original.codec;
+    }
+
+    if (job.spill_name.empty()) {
+        archive_file.write((char*)job.data.data(), job.data.size());
+        vector<Byte>().swap(job.data);
+    } else {
+        ifstream spill_file(toPath(job.spill_name), ios::binary);
+        vector<Byte> buf(0x100000);
+        while (spill_file.read((char*)buf.data(), buf.size()) || spill_file.gcount() > 0) {
+            archive_file.write((char*)buf.data(), spill_file.gcount());
+        }
+        spill_file.close();
+        error_code ec;
+        remove(toPath(job.spill_name), ec);
+    }
+    return archive_file.good();
+}
+
+// position in previous archive -> position in updated archive
+static QWord copiedPosition(vector<CopiedRange>& ranges, QWord pos) {
+    auto range = upper_bound(ranges.begin(), ranges.end(), pos,
+        [](QWord old_pos, const CopiedRange& copied) { return old_pos < copied.old_begin; });
+    if (range == ranges.begin()) return pos;
+    range--;
+    return pos < range->old_end ? range->new_begin + pos - range->old_begin : pos;
+}
+
+// copy compressed data of files with the same size and modification time as in previous archive
+bool Archive::copyUnchangedFiles(MappedFile &old_archive, ofstream &archive_file, FileList &old_list, vector<Byte>& reused) {
+    vector<FileInfo>&  list = *file_list->getFileList();
+    vector<FileInfo*>  old_files(list.size(), nullptr);
+    vector<CopiedRange> ranges;
+    reused.assign(list.size(), false);
+
+    for (QWord i = 0; i < list.size(); i++) {
+        FileHeader& file_header = list[i].file_header;
+        FileInfo*   old_file    = old_list.findFile(list[i].relative_file_name);
+        if ((file_header.flags & F_ISDIR) || !old_file || (old_file->file_header.flags & F_ISDIR) ||
+            old_file->file_header.file_size              != file_header.file_size ||
+            old_file->file_header.file_modification_time != file_header.file_modification_time) continue;
+        reused[i]    = true;
+        old_files[i] = old_file;
+    }
+
+    // solid group with changed or removed file is compressed again, copied whole it would keep stale data
+    unordered_map<QWord, QWord> group_files;
+    for (FileInfo& old_file : *old_list.getFileList()) {
+        if ((old_file.file_header.flags & (F_SOLID | F_DUPLICATE)) == F_SOLID) group_files[old_file.file_header.file_data_pos]++;
+    }
+    for (QWord i = 0; i < list.size(); i++) {
+        if (reused[i] && (old_files[i]->file_header.flags & (F_SOLID | F_DUPLICATE)) == F_SOLID) group_files[old_files[i]->file_header.file_data_pos]--;
+    }
+    for (QWord i = 0; i < list.size(); i++) {
+        if (reused[i] && (old_files[i]->file_header.flags & F_SOLID) && group_files[old_files[i]->file_header.file_data_pos] > 0) reused[i] = false;
+    }
+
+    for (QWord i = 0; i < list.size(); i++) {
+        if (!reused[i]) continue;
+
+        // data of file, solid group or original, chunks can be stored with other files
+        FileHeader& old_header = old_files[i]->file_header;
+        if (old_header.file_compressed_size > 0) {
+            ranges.push_back({ old_header.file_data_pos, old_header.file_data_pos + old_header.file_compressed_size, 0 });
+        }
+        for (ChunkPosition& chunk : old_files[i]->chunk_list) {
+            ranges.push_back({ chunk.out_pos, chunk.out_pos + chunk.compressed_size, 0 });
+        }
+    }
+
+    // shared and overlapping ranges are copied once, in order of previous archive
+    sort(ranges.begin(), ranges.end(), [](const CopiedRange& a, const CopiedRange& b) { return a.old_begin < b.old_begin; });
+    vector<CopiedRange> merged;
+    for (CopiedRange& range : ranges) {
+        if (!merged.empty() && range.old_begin <= merged.back().old_end) {
+            merged.back().old_end = max(merged.back().old_end, range.old_end);
+        } else {
+            merged.push_back(range);
+        }
+    }
+
+    for (CopiedRange& range : merged) {
+        if (range.old_end > old_archive.getSize()) return false;
+        range.new_begin = archive_file.tellp();
+        archive_file.write((char*)old_archive.getData() + range.old_begin, range.old_end - range.old_begin);
+        if (!archive_callback->callback(CLT_PROGRESS)) return false;
+    }
+
+    // reused files point to copied data
+    for (QWord i = 0; i < list.size(); i++) {
+        if (!reused[i]) continue;
+        FileInfo&   file_info  = list[i];
+        FileHeader& old_header = old_files[i]->file_header;
+        file_info.file_header.flags               |= old_header.flags & (F_SEEKTABLE | F_SOLID | F_DUPLICATE | F_CHUNKED | F_CODEC);
+        file_info.file_header.file_compressed_size = old_header.file_compressed_size;
+        file_info.file_header.file_data_pos        = copiedPosition(merged, old_header.file_data_pos);
+        file_info.file_header.file_solid_pos       = old_header.file_solid_pos;
+        file_info.file_header.file_hash            = old_header.file_hash;
+        file_info.seek_table                       = old_files[i]->seek_table;
+        file_info.chunk_list                       = old_files[i]->chunk_list;
+        file_info.codec                            = old_files[i]->codec;
+        for (ChunkPosition& chunk : file_info.chunk_list) chunk.out_pos = copiedPosition(merged, chunk.out_pos);
+    }
+    return archive_file.good();
+}
+
+// split file list into compression jobs, small files are grouped if solid mode is on
+void Archive::createCompressJobs(wstring &archive_name, vector<Byte>& reused, vector<CompressJob>& jobs) {
+    vector<FileInfo>& list = *file_list->getFileList();
+    QWord solid_job = (QWord)-1;
+
+    // similar files next to each other end up in one solid group
+    vector<QWord> order;
+    for (QWord i = 0; i < list.size(); i++) {
+        if (!(list[i].file_header.flags & F_ISDIR) && (reused.empty() || !reused[i])) order.push_back(i);
+    }
+    if (settings.solid_size > 0 && settings.solid_order != SO_LIST) {
+        file_list->sortFiles(order, settings.solid_order == SO_CONTENT, getThreadCount());
+    }
+
+    // identical files are stored once
+    vector<QWord> original;
+    if (settings.dedup) file_list->findDuplicates(order, original, getThreadCount());
+    vector<QWord> file_job(list.size(), 0);
+
+    for (QWord i : order) {
+        FileHeader& file_header = list[i].file_header;
+        if (settings.dedup && original[i] != i) continue;
+
+        // file joins open solid group until group reaches solid size
+        bool solid = file_header.file_size > 0 && file_header.file_size < settings.solid_size;
+        if (solid && solid_job < jobs.size() && jobs[solid_job].input_size + file_header.file_size <= settings.solid_size) {
+            jobs[solid_job].files.push_back(i);
+            jobs[solid_job].input_size += file_header.file_size;
+            file_job[i] = solid_job;
+            continue;
+        }
+
+        CompressJob job;
+        job.files.push_back(i);
+        job.input_size      = file_header.file_size;
+        job.compressed_size = 0;
+        job.data_pos        = 0;
+        job.preload         = false;
+        job.loaded          = false;
+        job.done            = false;
+        job.dedup           = false;
+        if (file_header.file_size > settings.spill_size) {
+            job.spill_name = archive_name + L"." + to_wstring(jobs.size()) + L".tmp";
+        }
+        if (solid) solid_job = jobs.size();
+        file_job[i] = jobs.size();
+        jobs.push_back(move(job));
+    }
+
+    // duplicates are written with job of their original
+    for (QWord i : order) {
+        if (settings.dedup && original[i] != i) jobs[file_job[original[i]]].duplicates.push_back({ i, original[i] });
+    }
+
+    // small files and solid groups are read in batches by input stage
+    if (settings.io_queue_depth > 0) {
+        for (CompressJob& job : jobs) {
+            bool chunked = settings.chunk_dedup && job.files.size() == 1 && job.input_size > CHUNK_MAX_SIZE;
+            job.preload  = job.files.size() > 1 || (job.input_size <= IO_BATCH_MAX_SIZE && !chunked);
+        }
+    }
+}
+
+// files of written job finished, compressed size of solid group is split between its files, duplicates take no space
+bool Archive::reportWrittenJob(CompressJob& job, wstring &archive_name, wstring &out_dir, QWord& finished_bytes, QWord total_size,
+                               clock_t archive_clock_start) {
+    vector<FileInfo>&    list = *file_list->getFileList();
+    ArchiveCallbackInfo& info = archive_callback->info;
+    info.archive_written_bytes += job.compressed_size;
+
+    vector<QWord> finished_files(job.files);
+    for (auto& duplicate : job.duplicates) finished_files.push_back(duplicate.first);
+    for (QWord f = 0; f < finished_files.size(); f++) {
+        FileInfo&   file_info   = list[finished_files[f]];
+        FileHeader& file_header = file_info.file_header;
+        QWord file_compressed_size = job.input_size > 0 ? job.compressed_size * file_header.file_size / job.input_size : job.compressed_size;
+        if (file_header.flags & F_DUPLICATE) file_compressed_size = 0;
+
+        finished_bytes         += file_header.file_size;
+        updateCallbackInfo(file_info, archive_name, out_dir);
+        info.file_read_bytes    = file_header.file_size;
+        info.file_written_bytes = file_compressed_size;
+        info.file_ratio         = COUNTPRECENT(file_compressed_size, file_header.file_size > 0 ? file_header.file_size : 1);
+        info.file_precent       = 100;
+        info.archive_read_bytes = finished_bytes;
+        info.archive_precent    = COUNTPRECENT(finished_bytes, total_size > 0 ? total_size : 1);
+        info.archive_ratio      = COUNTPRECENT(info.archive_written_bytes, finished_bytes > 0 ? finished_bytes : 1);
+        info.archive_clock      = COUNTTIME(archive_clock_start);
+        info.file_clock         = info.archive_clock;
+        if (!archive_callback->callback(CLT_FILE_BEGIN) || !archive_callback->callback(CLT_FILE_FINISH)) return false;
+    }
     return true;
 }
 
+// compress files on worker threads, write them to archive in job order
+bool Archive::compressFiles(ofstream &archive_file, wstring &archive_name, vector<Byte>& reused) {
+    vector<FileInfo>& list = *file_list->getFileList();
+    vector<CompressJob> jobs;
+    createCompressJobs(archive_name, reused, jobs);
+
+    // workers run at most window jobs ahead of writer, it bounds memory used by compressed data
+    DWord thread_count = getThreadCount();
+    QWord window       = (QWord)thread_count * 2;
+    QWord written      = 0;
+    bool  cancelled    = false;
+    atomic<QWord> next_job(0), read_bytes(0);
+    mutex compressed_mutex;
+    condition_variable job_done, job_written;
+    ChunkIndex chunk_index;
+
+    // input stage - small files are read in batches ahead of workers, it can run further ahead than them
+    thread loader;
+    if (settings.io_queue_depth > 0) {
+        loader = thread([&]() {
+            unique_ptr<IOBackendInterface> io_backend(createIOBackend(settings.io_queue_depth));
+            QWord               lead = window + settings.io_queue_depth;
+            vector<FileRequest> batch;
+            vector<QWord>       batch_jobs;
+
+            auto readBatch = [&]() {
+                if (batch_jobs.empty()) return;
+                io_backend->read(batch);
+
+                // single file keeps size it had when read, solid group keeps its size as before
+                lock_guard<mutex> lock(compressed_mutex);
+                QWord request = 0;
+                for (QWord j : batch_jobs) {
+                    if (jobs[j].files.size() == 1) jobs[j].input.resize(batch[request].done);
+                    request += jobs[j].files.size();
+                    jobs[j].loaded = true;
+                }
+                job_written.notify_all();
+                batch.clear();
+                batch_jobs.clear();
+            };
+
+            for (QWord i = 0; i < jobs.size(); i++) {
+                if (!jobs[i].preload) continue;
+                {
+                    // pending batch is read once workers reach it, otherwise it grows up to queue depth
+                    unique_lock<mutex> lock(compressed_mutex);
+                    while (i >= written + lead && !cancelled) {
+                        job_written.wait(lock, [&] {
+                            return i < written + lead || cancelled || (!batch_jobs.empty() && batch_jobs[0] < written + window);
+                        });
+                        if (!batch_jobs.empty() && batch_jobs[0] < written + window && !cancelled) {
+                            lock.unlock();
+                            readBatch();
+                            lock.lock();
+                        }
+                    }
+                    if (cancelled) break;
+                }
+
+                CompressJob& job = jobs[i];
+                job.input.resize(job.input_size);
+                QWord solid_pos = 0;
+                for (QWord f : job.files) {
+                    QWord file_size = list[f].file_header.file_size;
+                    batch.push_back({ list[f].absolute_file_name, job.input.data() + solid_pos, file_size, 0, false, nullptr });
+                    solid_pos += file_size;
+                }
+                batch_jobs.push_back(i);
+                if (batch.size() >= settings.io_queue_depth) readBatch();
+            }
+            readBatch();
+        });
+    }
+
+    vector<thread> workers;
+    for (DWord t = 0; t < thread_count; t++) {
+        workers.emplace_back([&]() {
+            CodecSet*       worker_codecs = createCodecs();
+            Hashing         worker_hashing;
+
+            for (QWord i = next_job++; i < jobs.size(); i = next_job++) {
+                {
+                    unique_lock<mutex> lock(compressed_mutex);
+                    job_written.wait(lock, [&] { return (i < written + window && (!jobs[i].preload || jobs[i].loaded)) || cancelled; });
+                    if (cancelled) break;
+                }
+                compressJob(jobs[i], i, worker_codecs, &worker_hashing, chunk_index, read_bytes);
+
+                lock_guard<mutex> lock(compressed_mutex);
+                jobs[i].done = true;
+                job_done.notify_all();
+            }
+            delete worker_codecs;
+        });
+    }
+
+    // writer
+    ArchiveCallbackInfo& info = archive_callback->info;
+    QWord   total_size        = 0;
+    QWord   finished_bytes    = 0;
+    clock_t archive_clock_start = clock();
+    wstring out_dir           = fromPath(toPath(archive_name).parent_path());
+    bool    ok                = true;
+    info.archive_read_bytes    = 0;
+    info.archive_written_bytes = 0;
+    for (CompressJob& job : jobs) {
+        total_size += job.input_size;
+        for (auto& duplicate : job.duplicates) total_size += list[duplicate.first].file_header.file_size;
+    }
+
+    for (QWord i = 0; i < jobs.size() && ok; i++) {
+        CompressJob& job = jobs[i];
+
+        // worker writes hash and flags of job files, only name set by scanner is reported before job is done
+        updateCallbackNames(list[job.files[0]].relative_file_name, archive_name, out_dir);
+        info.file_read_bytes    = 0;
+        info.file_written_bytes = 0;
+
+        // report progress of workers while waiting for next job
+        unique_lock<mutex> lock(compressed_mutex);
+        while (ok && !job_done.wait_for(lock, chrono::milliseconds(100), [&] { return job.done; })) {
+            lock.unlock();
+            info.archive_read_bytes = read_bytes;
+            info.archive_precent    = COUNTPRECENT(info.archive_read_bytes, total_size > 0 ? total_size : 1);
+            info.archive_clock      = COUNTTIME(archive_clock_start);
+            info.file_clock         = info.archive_clock;
+            ok = archive_callback->callback(CLT_PROGRESS);
+            lock.lock();
+        }
+        lock.unlock();
+        if (ok) updateCallbackInfo(list[job.files[0]]);
+
+        if (ok) ok = writeCompressedJob(archive_file, job);
+        if (ok) ok = reportWrittenJob(job, archive_name, out_dir, finished_bytes, total_size, archive_clock_start);
+
+        lock.lock();
+        written   = i + 1;
+        cancelled = !ok;
+        job_written.notify_all();
+    }
+    {
+        lock_guard<mutex> lock(compressed_mutex);
+        cancelled = !ok;
+        job_written.notify_all();
+    }
+    for (thread& worker : workers) worker.join();
+    if (loader.joinable()) loader.join();
+
+    // chunk positions are known when all jobs are written
+    for (CompressJob& job : jobs) {
+        if (!ok || job.chunk_ids.empty()) continue;
+        FileInfo& file_info = list[job.files[0]];
+        for (QWord c = 0; c < job.chunk_ids.size(); c++) {
+            ChunkLocation& location = chunk_index.locations[job.chunk_ids[c]];
+            file_info.chunk_list[c].out_pos         = jobs[location.job].data_pos + location.out_pos;
+            file_info.chunk_list[c].compressed_size = location.compressed_size;
+        }
+        for (auto& duplicate : job.duplicates) list[duplicate.first].chunk_list = file_info.chunk_list;
+    }
+
+    // temporary files left after cancel or error
+    for (CompressJob& job : jobs) {
+        error_code ec;
+        if (!job.spill_name.empty()) remove(toPath(job.spill_name), ec);
+    }
+    return ok;
+}
+
+// strong hash of whole file, empty if it could not be read whole
+static string fileDigest(const wstring& file_name, QWord file_size) {
+    StrongHashing strong_hashing;
+    vector<Byte>  buf((size_t)min(file_size, (QWord)0x100000));
+    QWord read_size = 0;
+    ifstream ifile(toPath(file_name), ios::binary);
+    strong_hashing.init();
+    while (ifile.read((char*)buf.data(), buf.size()) || ifile.gcount() > 0) {
+        strong_hashing.updateHash(buf.data(), ifile.gcount());
+        read_size += ifile.gcount();
+    }
+    if (read_size != file_size) return string();
+
+    Byte digest[STRONG_HASH_SIZE];
+    strong_hashing.getHash(digest);
+    return string((char*)digest, STRONG_HASH_SIZE);
+}
+
+// streamed file sharing size with earlier file is hashed, found duplicate is not compressed (worker thread)
+static void hashStreamedFile(CompressJob& job, DedupIndex& dedup_index) {
+    QWord file_index = job.files[0];
+    QWord file_size  = job.input_size;
+    if (!job.preload) {
+        job.digest = fileDigest(job.entries.back().absolute_file_name, file_size);
+    } else if (job.input.size() == file_size) {
+        StrongHashing strong_hashing;
+        Byte digest[STRONG_HASH_SIZE];
+        strong_hashing.init();
+        strong_hashing.updateHash(job.input.data(), job.input.size());
+        strong_hashing.getHash(digest);
+        job.digest.assign((char*)digest, STRONG_HASH_SIZE);
+    }
+    string first_digest = job.first_name.empty() ? string() : fileDigest(job.first_name, file_size);
+
+    // earlier of identical files is kept, all earlier files of same size are hashed before writer reaches this one
+    lock_guard<mutex> lock(dedup_index.index_mutex);
+    for (auto& file : { make_pair(first_digest, job.first_file), make_pair(job.digest, file_index) }) {
+        if (file.first.empty()) continue;
+        auto original = dedup_index.originals.emplace(file.first, file.second);
+        if (!original.second && file.second < original.first->second) original.first->second = file.second;
+    }
+    if (!job.digest.empty() && dedup_index.originals[job.digest] < file_index)
+        job.duplicates.push_back({ file_index, dedup_index.originals[job.digest] });
+}
+
+// compress files while directories are still scanned, every stage runs at most lead jobs ahead of writer
+// and input stage reads ahead only while file data and compressed data fit in pipeline memory
+bool Archive::streamFiles(ofstream &archive_file, wstring &archive_name) {
+    vector<FileInfo>& list = *file_list->getFileList();
+    DWord thread_count = getThreadCount();
+    QWord lead         = max(STREAM_JOB_COUNT, (QWord)thread_count * 2 + settings.io_queue_depth);
+    deque<CompressJob> jobs;            // jobs not written yet, references stay valid while it grows
+    QWord planned_bytes = 0, memory = 0, compressed_jobs = 0;
+    bool  planned = false, cancelled = false;
+    mutex compressed_mutex;
+    condition_variable job_done, job_written;
+    WorkQueue<CompressJob*> ready(lead);
+    atomic<QWord> read_bytes(0);
+    ChunkIndex chunk_index;
+    DedupIndex dedup_index;
+    memset(&pipeline_stats, 0, sizeof(PipelineStats));
+
+    // input stage - entries are grouped with next file into jobs in list order, small files are read in batches if asked
+    thread input([&]() {
+        unique_ptr<IOBackendInterface> io_backend(settings.io_queue_depth > 0 ? createIOBackend(settings.io_queue_depth) : nullptr);
+        unordered_map<QWord, pair<QWord, wstring>> first_of_size;    // file size -> first file, its name until second is found
+        vector<FileInfo>     entries;
+        vector<FileRequest>  batch;
+        vector<CompressJob*> batch_jobs;
+        QWord file_index = 0;
+
+        auto readBatch = [&]() {
+            if (batch_jobs.empty()) return;
+            io_backend->read(batch);
+            for (QWord k = 0; k < batch_jobs.size(); k++) {
+                CompressJob* job = batch_jobs[k];
+                job->input.resize(batch[k].done);
+                ready.push(move(job));
+            }
+            batch.clear();
+            batch_jobs.clear();
+        };
+
+        FileInfo fi;
+        while (true) {
+            // batch is not held back while scanner is slower than workers
+            if (file_list->getStreamSize() == 0) readBatch();
+            if (!file_list->nextFile(fi)) break;
+            QWord index     = file_index++;
+            QWord file_size = fi.file_header.file_size;
+            bool  dir       = (fi.file_header.flags & F_ISDIR) != 0;
+            entries.push_back(move(fi));
+            if (dir) continue;
+
+            CompressJob job;
+            job.files.push_back(index);
+            job.input_size      = file_size;
+            job.compressed_size = 0;
+            job.data_pos        = 0;
+            job.preload         = settings.io_queue_depth > 0 && file_size <= IO_BATCH_MAX_SIZE;
+            job.loaded          = false;
+            job.done            = false;
+            job.dedup           = false;
+            job.first_file      = 0;
+            job.entries.swap(entries);
+            if (file_size > settings.spill_size) {
+                job.spill_name = archive_name + L"." + to_wstring(index) + L".tmp";
+            }
+
+            // identical files share size, file is hashed once another file of its size is found
+            if (settings.dedup && file_size > 0) {
+                auto first = first_of_size.emplace(file_size, make_pair(index, job.entries.back().absolute_file_name));
+                if (!first.second) {
+                    job.dedup      = true;
+                    job.first_file = first.first->second.first;
+                    job.first_name.swap(first.first->second.second);
+                }
+            }
+
+            // read data is charged until it is compressed, batch is read before waiting as writer can need it
+            QWord charge = job.preload ? file_size : 0;
+            CompressJob* planned_job;
+            {
+                unique_lock<mutex> lock(compressed_mutex);
+                while (!cancelled && (jobs.size() >= lead || (memory > 0 && memory + charge > settings.pipeline_memory))) {
+                    if (!batch_jobs.empty()) {
+                        lock.unlock();
+                        readBatch();
+                        lock.lock();
+                        continue;
+                    }
+                    job_written.wait(lock);
+                }
+                if (cancelled) break;
+                memory        += charge;
+                planned_bytes += file_size;
+                pipeline_stats.max_memory = max(pipeline_stats.max_memory, memory);
+                jobs.push_back(move(job));
+                planned_job = &jobs.back();
+            }
+
+            if (planned_job->preload) {
+                planned_job->input.resize(file_size);
+                batch.push_back({ planned_job->entries.back().absolute_file_name, planned_job->input.data(), file_size, 0, false, nullptr });
+                batch_jobs.push_back(planned_job);
+                if (batch.size() >= settings.io_queue_depth || ready.size() < thread_count) readBatch();
+            } else {
+                readBatch();
+                ready.push(move(planned_job));
+            }
+        }
+        readBatch();
+        ready.close();
+
+        // entries after last file are put to list by job without files
+        lock_guard<mutex> lock(compressed_mutex);
+        if (!entries.empty() && !cancelled) {
+            CompressJob job;
+            job.input_size      = 0;
+            job.compressed_size = 0;
+            job.data_pos        = 0;
+            job.preload         = false;
+            job.loaded          = false;
+            job.done            = true;
+            job.dedup           = false;
+            job.first_file      = 0;
+            job.entries.swap(entries);
+            jobs.push_back(move(job));
+        }
+        planned = true;
+        job_done.notify_all();
+    });
+
+    vector<thread> workers;
+    for (DWord t = 0; t < thread_count; t++) {
+        workers.emplace_back([&]() {
+            CodecSet*       worker_codecs = createCodecs();
+            Hashing         worker_hashing;
+            CompressJob*    job;
+
+            while (ready.pop(job)) {
+                {
+                    lock_guard<mutex> lock(compressed_mutex);
+                    if (cancelled) continue;
+                }
+                if (job->dedup) hashStreamedFile(*job, dedup_index);
+                if (job->duplicates.empty()) {
+                    compressJob(*job, job->files[0], worker_codecs, &worker_hashing, chunk_index, read_bytes);
+                } else {
+                    read_bytes += job->input_size;
+                    vector<Byte>().swap(job->input);
+                }
+
+                // compressed data replaces read data until job is written
+                lock_guard<mutex> lock(compressed_mutex);
+                memory += job->data.size();
+                memory -= job->preload ? job->input_size : 0;
+                pipeline_stats.max_memory = max(pipeline_stats.max_memory, memory);
+                job->done = true;
+                compressed_jobs++;
+                pipeline_stats.compress.pushed++;
+                pipeline_stats.compress.depth_sum += compressed_jobs;
+                pipeline_stats.compress.max_depth  = max(pipeline_stats.compress.max_depth, (size_t)compressed_jobs);
+                job_done.notify_all();
+            }
+            delete worker_codecs;
+        });
+    }
+
+    // writer
+    ArchiveCallbackInfo& info = archive_callback->info;
+    QWord   finished_bytes      = 0;
+    clock_t archive_clock_start = clock();
+    wstring out_dir             = fromPath(toPath(archive_name).parent_path());
+    bool    ok                  = true;
+    info.archive_read_bytes    = 0;
+    info.archive_written_bytes = 0;
+
+    while (ok) {
+        // report progress of workers while waiting for next job, total grows while files are scanned
+        unique_lock<mutex> lock(compressed_mutex);
+        while (ok && !job_done.wait_for(lock, chrono::milliseconds(100), [&] { return (!jobs.empty() && jobs.front().done) || (planned && jobs.empty()); })) {
+            QWord total_size = planned_bytes;
+            lock.unlock();
+            info.archive_read_bytes = read_bytes;
+            info.archive_precent    = COUNTPRECENT(info.archive_read_bytes, total_size > 0 ? total_size : 1);
+            info.archive_clock      = COUNTTIME(archive_clock_start);
+            info.file_clock         = info.archive_clock;
+            ok = archive_callback->callback(CLT_PROGRESS);
+            lock.lock();
+        }
+        if (!ok || jobs.empty()) break;
+        CompressJob& job = jobs.front();
+        QWord total_size = planned_bytes;
+        if (!job.files.empty()) compressed_jobs--;
+        lock.unlock();
+
+        // entries are put to list in order, file of job is last of them
+        for (FileInfo& entry : job.entries) file_list->appendFile(entry);
+        vector<FileInfo>().swap(job.entries);
+
+        // duplicate is decided when all earlier files of its size are hashed, its compressed data is dropped
+        if (job.dedup && !job.digest.empty()) {
+            QWord file_index = job.files[0], original;
+            {
+                lock_guard<mutex> index_lock(dedup_index.index_mutex);
+                original = dedup_index.originals[job.digest];
+            }
+            if (original < file_index) {
+                FileInfo& file_info = list[file_index];
+                file_info.file_header.flags = 0;
+                file_info.seek_table.clear();
+                if (!job.spill_name.empty()) {
+                    error_code ec;
+                    remove(toPath(job.spill_name), ec);
+                    job.spill_name.clear();
+                }
+                lock.lock();
+                memory -= job.data.size();
+                lock.unlock();
+                vector<Byte>().swap(job.data);
+                job.compressed_size = 0;
+                job.files.clear();
+                job.duplicates.assign(1, { file_index, original });
+            }
+        }
+
+        if (!job.files.empty() || !job.duplicates.empty()) {
+            QWord data_size = job.data.size();
+            ok = writeCompressedJob(archive_file, job);
+            if (ok) ok = reportWrittenJob(job, archive_name, out_dir, finished_bytes, total_size, archive_clock_start);
+            lock.lock();
+            memory -= data_size;
+            lock.unlock();
+        }
+
+        lock.lock();
+        jobs.pop_front();
+        job_written.notify_all();
+    }
+
+    // stages stop taking work after cancel or error, scan is finished
+    {
+        lock_guard<mutex> lock(compressed_mutex);
+        cancelled = !ok;
+        job_written.notify_all();
+    }
+    if (!ok) file_list->closeStream();
+    input.join();
+    for (thread& worker : workers) worker.join();
+    file_list->waitUntilCompleted();
+    pipeline_stats.scan = file_list->getStreamStats();
+    pipeline_stats.read = ready.getStats();
+
+    // temporary files left after cancel or error
+    for (CompressJob& job : jobs) {
+        error_code ec;
+        if (!job.spill_name.empty()) remove(toPath(job.spill_name), ec);
+    }
+    return ok;
+}
+
+// decompress file or solid group from positioned archive reader (worker thread)
+void Archive::decompressJob(MappedFile &archive_map, DecompressJob& job, wstring &extract_dir, CodecSet* worker_codecs,
+                            HashingInterface* worker_hashing, IOBackendInterface* io_backend, atomic<QWord>& written_bytes,
+                            vector<Byte>& valid) {
+    FileHeader&     file_header  = job.files[0]->file_header;
+    CodecInterface* worker_codec = worker_codecs->get(job.files[0]->codec);
+
+    // decompress -> split into files, hash and write them, files of unknown codec are left invalid
+    SplitOutputStream ocodec(job.files, valid, extract_dir, worker_hashing, &written_bytes, io_backend, settings.io_queue_depth);
+    if (worker_codec && (file_header.flags & F_CHUNKED)) {
+        // chunks can be stored anywhere in archive
+        for (ChunkPosition& chunk : job.files[0]->chunk_list) {
+            MappedInputStream icodec(&archive_map, chunk.out_pos, chunk.compressed_size);
+            worker_codec->decompressStream(&icodec, &ocodec);
+            if (worker_codec->isCorrupted()) break;
+        }
+    } else if (worker_codec) {
+        MappedInputStream icodec(&archive_map, file_header.file_data_pos, file_header.file_compressed_size);
+        worker_codec->decompressStream(&icodec, &ocodec);
+    }
+    ocodec.finish();
+
+    // duplicates are copied or linked from extracted original
+    for (QWord c = 0; c < job.copies.size(); c++) {
+        QWord source = job.sources[c];
+        Byte& copy_valid = valid[job.files.size() + c];
+        copy_valid = valid[source];
+        if (!copy_valid || extract_dir.empty()) continue;
+
+        path source_name = toPath(extract_dir) / toPath(job.files[source]->relative_file_name);
+        path copy_name   = toPath(extract_dir) / toPath(job.copies[c]->relative_file_name);
+        error_code ec;
+        if (settings.hard_links) {
+            create_hard_link(source_name, copy_name, ec);
+            if (!ec) continue;
+            ec.clear();
+        }
+        copy_file(source_name, copy_name, copy_options::overwrite_existing, ec);
+        copy_valid = !ec;
+        if (copy_valid) file_list->updateFile(*job.copies[c], extract_dir);
+    }
+}
+
+// files sharing compressed data (solid group, duplicates) are decompressed together, every other file alone
+void Archive::createDecompressJobs(vector<FileInfo*>& files, vector<DecompressJob>& jobs) {
+    unordered_map<QWord, QWord> shared_jobs;   // data position -> job
+    for (FileInfo* file_info : files) {
+        FileHeader& file_header = file_info->file_header;
+        if (file_header.flags & F_ISDIR) continue;
+
+        if (file_header.file_compressed_size > 0) {
+            auto shared_job = shared_jobs.find(file_header.file_data_pos);
+            if (shared_job != shared_jobs.end()) {
+                jobs[shared_job->second].files.push_back(file_info);
+                continue;
+            }
+            shared_jobs[file_header.file_data_pos] = jobs.size();
+        }
+        DecompressJob job;
+        job.files.push_back(file_info);
+        jobs.push_back(move(job));
+    }
+
+    for (DecompressJob& job : jobs) {
+        // files in order of decompressed data, originals before their duplicates
+        stable_sort(job.files.begin(), job.files.end(), [](FileInfo* a, FileInfo* b) {
+            if (streamPos(a) != streamPos(b)) return streamPos(a) < streamPos(b);
+            return (a->file_header.flags & F_DUPLICATE) < (b->file_header.flags & F_DUPLICATE);
+        });
+
+        // file with same data as previous one is copy of it
+        vector<FileInfo*> unique_files;
+        for (FileInfo* file_info : job.files) {
+            FileInfo* previous = unique_files.empty() ? nullptr : unique_files.back();
+            if (previous && streamPos(previous) == streamPos(file_info) &&
+                previous->file_header.file_size == file_info->file_header.file_size) {
+                job.copies.push_back(file_info);
+                job.sources.push_back(unique_files.size() - 1);
+            } else {
+                unique_files.push_back(file_info);
+            }
+        }
+        job.files.swap(unique_files);
+    }
+}
+
 // write archive header
 void Archive::writeArchiveHeader(ofstream &ofile) {
     archive_header.signature1 = SCL_ARCHIVE_SIGNATURE1;
@@ -162,17 +1251,48 @@ bool Archive::readArchiveHeader(ifstream &ifile) {
                    archive_header.signature1 == SCL_ARCHIVE_SIGNATURE1);
 }
 
+bool Archive::readArchiveHeader(MappedFile &archive_map) {
+    if (archive_map.getSize() < sizeof(ArchiveHeader)) return false;
+    memcpy(&archive_header, archive_map.getData(), sizeof(ArchiveHeader));
+    // check signature
+    return (memcmp(archive_header.signature0, SCL_ARCHIVE_SIGNATURE0, sizeof(SCL_ARCHIVE_SIGNATURE0)) == 0 &&
+                   archive_header.signature1 == SCL_ARCHIVE_SIGNATURE1);
+}
+
+// write compact directory, header written after it points to it
+void Archive::writeFileList(ofstream &ofile) {
+    archive_header.file_list_pos = ofile.tellp();
+    archive_header.flags        |= AF_COMPACT_LIST;
+    CodecInterface* list_codec = createCodec();
+    file_list->writeFileList(ofile, list_codec);
+    delete list_codec;
+}
+
+// read directory in format given by archive header
+bool Archive::readFileList(MappedFile &archive_map, FileList &list) {
+    if (archive_header.file_list_pos > archive_map.getSize()) return false;
+    MappedInputStream input(&archive_map, archive_header.file_list_pos, archive_map.getSize() - archive_header.file_list_pos);
+    if (!(archive_header.flags & AF_COMPACT_LIST)) return list.readFileList(&input, sizeof(ArchiveHeader));
+    CodecInterface* list_codec = createCodec();
+    bool ok = list.readFileList(&input, list_codec);
+    delete list_codec;
+    return ok;
+}
+
 // update callback info
 void Archive::updateCallbackInfo(FileInfo &file_info, wstring &archive_name, wstring &output_path) {
-    path file_name_path(file_info.relative_file_name);
-    path archive_name_path(archive_name);
+    updateCallbackNames(file_info.relative_file_name, archive_name, output_path);
+    updateCallbackInfo(file_info);
+}
+void Archive::updateCallbackNames(const wstring &relative_file_name, wstring &archive_name, wstring &output_path) {
+    path file_name_path    = toPath(relative_file_name);
+    path archive_name_path = toPath(archive_name);
 
-    archive_callback->info.file_name    = file_name_path.filename();
-    archive_callback->info.file_path    = file_name_path.parent_path();
-    archive_callback->info.archive_file = archive_name_path.filename();
-    archive_callback->info.archive_path = archive_name_path.parent_path();
+    archive_callback->info.file_name    = fromPath(file_name_path.filename());
+    archive_callback->info.file_path    = fromPath(file_name_path.parent_path());
+    archive_callback->info.archive_file = fromPath(archive_name_path.filename());
+    archive_callback->info.archive_path = fromPath(archive_name_path.parent_path());
     archive_callback->info.output_path  = output_path;
-    updateCallbackInfo(file_info);
 }
 void Archive::updateCallbackInfo(FileInfo& file_info) {
     archive_callback->info.file_ID             = file_info.file_header.file_ID;
@@ -182,110 +1302,581 @@ void Archive::updateCallbackInfo(FileInfo& file_info) {
     archive_callback->info.file_modification_time.set(file_info.file_header.file_modification_time);
 }
 
+// create file list, callback reports number of files found so far
+bool Archive::scanFiles(vector<wstring> &files) {
+    file_list->createFileList(files, getThreadCount());
+
+    while (!file_list->isCompleted(SCAN_PROGRESS_INTERVAL)) {
+        archive_callback->info.number_of_files = file_list->getScannedCount();
+        if (!archive_callback->callback(CLT_COUNTING_FILES)) return false;
+    }
+    archive_callback->info.number_of_files = file_list->getScannedCount();
+    return archive_callback->callback(CLT_COUNTING_FILES_FINISH);
+}
+
 // create archive from directory or file
 bool Archive::archiveCreate(vector<wstring> &files, wstring &archive_name) {
     // init callback
-    codec_callback->init();
     archive_callback->info.callback_action = CLA_COMPRESS;
 
+    // solid groups and chunks are planned for whole file list, other files are compressed while they are scanned
+    bool stream = settings.pipeline_memory > 0 && settings.solid_size == 0 && !settings.chunk_dedup;
+
     // create file lsit
-    file_list->createFileList(files);
+    if (stream) file_list->createFileList(files, getThreadCount(), STREAM_QUEUE_SIZE);
+    else if (!scanFiles(files)) return false;
 
-    while (!file_list->isCompleted()) {
-        archive_callback->info.number_of_files = file_list->getFileList()->size();
-        if (!archive_callback->callback(CLT_COUNTING_FILES)) return false;
+    // callbacks, number of streamed files is not known yet
+    archive_callback->info.number_of_files = file_list->getNumberOfFiles() + file_list->getNumberOfFolders();
+    if (!archive_callback->callback(CLT_ARCHIVE_BEGIN)) {
+        file_list->closeStream();
+        return false;
     }
 
+    // open archive file and write header
+    ofstream archive_file(toPath(archive_name), ios::binary);
+    memset(&archive_header, 0, sizeof(ArchiveHeader));
+    if (settings.block_checksum) archive_header.flags |= AF_BLOCK_CHECKSUM;
+    if (settings.compact_blocks) archive_header.flags |= AF_COMPACT_BLOCKS;
+    writeArchiveHeader(archive_file);
+
+    // compress files
+    vector<Byte> reused;
+    if (stream ? !streamFiles(archive_file, archive_name) : !compressFiles(archive_file, archive_name, reused)) return false;
+    
+    // write file list
+    writeFileList(archive_file);
+
+    // write header again
+    archive_file.seekp(0);
+    writeArchiveHeader(archive_file);
+    if (!archive_callback->callback(CLT_ARCHIVE_FINISH)) return false;
+    return true;
+}
+
+// recreate archive, compressed data of unchanged files is copied from previous archive
+bool Archive::archiveUpdate(vector<wstring> &files, wstring &archive_name) {
+    // read previous archive, its blocks format is kept
+    MappedFile old_archive;
+    if (!old_archive.open(archive_name.c_str()) || !readArchiveHeader(old_archive)) return false;
+    FileList old_list;
+    if (!readFileList(old_archive, old_list)) return false;
+
+    // init callback
+    archive_callback->info.callback_action = CLA_COMPRESS;
+
+    // create file list
+    if (!scanFiles(files)) return false;
+
     // callbacks
-    codec_callback->setTotalBytesToProcess(file_list->getSizeOfAllFiles());
     archive_callback->info.number_of_files = file_list->getNumberOfFiles() + file_list->getNumberOfFolders();
     if (!archive_callback->callback(CLT_ARCHIVE_BEGIN)) return false;
 
-    // open archive file and write header
-    ofstream archive_file(archive_name, ios::binary);
-    memset(&archive_header, 0, sizeof(ArchiveHeader));
+    // updated archive replaces previous one when complete
+    wstring  update_name = archive_name + L".update.tmp";
+    ofstream archive_file(toPath(update_name), ios::binary);
+    archive_header.file_list_pos = 0;
     writeArchiveHeader(archive_file);
 
-    // process files
-    vector<FileInfo> *list = file_list->getFileList();
-    for (FileInfo& file_info : *list) {
+    // copy unchanged files, compress new and changed files
+    vector<Byte> reused;
+    bool ok = copyUnchangedFiles(old_archive, archive_file, old_list, reused) &&
+              compressFiles(archive_file, archive_name, reused);
 
-        // skip directory
-        if (file_info.file_header.flags & F_ISDIR) continue;
+    // write file list and header again
+    if (ok) {
+        writeFileList(archive_file);
+        archive_file.seekp(0);
+        writeArchiveHeader(archive_file);
+        ok = archive_file.good();
+    }
+    archive_file.close();
+    old_archive.close();
 
-        // update callback info
-        wstring out_dir = path(archive_name).parent_path();
-        updateCallbackInfo(file_info, archive_name, out_dir);
+    error_code ec;
+    if (ok) {
+        rename(toPath(update_name), toPath(archive_name), ec);
+        ok = !ec;
+    }
+    if (!ok) {
+        remove(toPath(update_name), ec);
+        return false;
+    }
+    if (!archive_callback->callback(CLT_ARCHIVE_FINISH)) return false;
+    return true;
+}
+
+// append files to archive, data and directory already in archive are not rewritten
+bool Archive::archiveAppend(vector<wstring> &files, wstring &archive_name) {
+    if (!exists(toPath(archive_name))) return archiveCreate(files, archive_name);
 
-        // compress files
-        ifstream ifile(file_info.absolute_file_name, ios::binary);
-        if (!compressFile(ifile, archive_file, file_info)) return false;
+    // read current directory, its blocks format is kept
+    MappedFile old_archive;
+    if (!old_archive.open(archive_name.c_str()) || !readArchiveHeader(old_archive)) return false;
+    FileList old_list;
+    if (!readFileList(old_archive, old_list)) return false;
+    old_archive.close();
+
+    // init callback
+    archive_callback->info.callback_action = CLA_COMPRESS;
+
+    // create file list
+    if (!scanFiles(files)) return false;
+
+    // unchanged files keep their data, files not given are kept as they are
+    vector<FileInfo>& list = *file_list->getFileList();
+    vector<Byte> reused(list.size(), false);
+    vector<Byte> replaced(old_list.getFileList()->size(), false);
+    for (QWord i = 0; i < list.size(); i++) {
+        FileInfo* old_file = old_list.findFile(list[i].relative_file_name);
+        if (!old_file) continue;
+        replaced[old_file - old_list.getFileList()->data()] = true;
+
+        FileHeader& file_header = list[i].file_header;
+        FileHeader& old_header  = old_file->file_header;
+        if ((file_header.flags & F_ISDIR) || (old_header.flags & F_ISDIR) ||
+            old_header.file_size              != file_header.file_size ||
+            old_header.file_modification_time != file_header.file_modification_time) continue;
+        reused[i]                        = true;
+        file_header.flags               |= old_header.flags & (F_SEEKTABLE | F_SOLID | F_DUPLICATE | F_CHUNKED | F_CODEC);
+        file_header.file_compressed_size = old_header.file_compressed_size;
+        file_header.file_data_pos        = old_header.file_data_pos;
+        file_header.file_solid_pos       = old_header.file_solid_pos;
+        file_header.file_hash            = old_header.file_hash;
+        list[i].seek_table               = old_file->seek_table;
+        list[i].chunk_list               = old_file->chunk_list;
+        list[i].codec                    = old_file->codec;
+    }
+    for (QWord i = 0; i < replaced.size(); i++) {
+        if (replaced[i]) continue;
+        file_list->appendFile((*old_list.getFileList())[i]);
+        reused.push_back(true);
     }
-    
-    // write file list
-    archive_header.file_list_pos = archive_file.tellp();
-    file_list->writeFileList(archive_file);
 
-    // write header again
+    // callbacks
+    archive_callback->info.number_of_files = file_list->getNumberOfFiles() + file_list->getNumberOfFolders();
+    if (!archive_callback->callback(CLT_ARCHIVE_BEGIN)) return false;
+
+    // new data and directory go after previous directory, archive stays valid until header is rewritten
+    ofstream archive_file(toPath(archive_name), ios::in | ios::out | ios::binary);
+    if (!archive_file.is_open()) return false;
+    archive_file.seekp(0, ios::end);
+    if (!compressFiles(archive_file, archive_name, reused)) return false;
+
+    writeFileList(archive_file);
+    archive_file.flush();
+    if (!archive_file.good()) return false;
+
+    // header points to latest directory
     archive_file.seekp(0);
     writeArchiveHeader(archive_file);
+    archive_file.close();
     if (!archive_callback->callback(CLT_ARCHIVE_FINISH)) return false;
     return true;
 }
 
 // archive extracting function
 bool Archive::archiveExtract(wstring &archive_name, wstring &extract_dir) {
-    ifstream archive_file(archive_name, ios::binary);
+    vector<wstring> all_files;
+    return archiveExtract(archive_name, extract_dir, all_files);
+}
+
+// extract files matching given names or patterns, all files if none given
+bool Archive::archiveExtract(wstring &archive_name, wstring &extract_dir, vector<wstring> &patterns) {
+    MappedFile archive_file;
+    if (!archive_file.open(archive_name.c_str())) return false;
+
+    // data is decoded from begin to end, kernel reads ahead while blocks are decoded
+    archive_file.adviseSequential();
 
     // read header
     if (!readArchiveHeader(archive_file)) return false;
 
     // read file list
-    archive_file.seekg(archive_header.file_list_pos);
-    file_list->readFileList(archive_file);
-    vector<FileInfo>* list = file_list->getFileList();
+    if (!readFileList(archive_file, *file_list)) return false;
 
-    // return to data position
-    archive_file.seekg(sizeof(ArchiveHeader));
+    // select files
+    vector<FileInfo*> selected;
+    if (patterns.empty()) {
+        for (FileInfo& file_info : *file_list->getFileList()) selected.push_back(&file_info);
+    } else {
+        file_list->selectFiles(patterns, selected);
+    }
 
     // callbacks
     archive_callback->info.callback_action = CLA_DECOMPRESS;
-    archive_callback->info.number_of_files = file_list->getNumberOfFiles() + file_list->getNumberOfFolders();
-    codec_callback->init();
-    codec_callback->setTotalBytesToProcess(file_list->getSizeOfAllFiles());
+    archive_callback->info.number_of_files = selected.size();
     if (!archive_callback->callback(CLT_ARCHIVE_BEGIN)) return false;
 
     // process files
-    create_directories(extract_dir);
-    for (FileInfo& file_info : *list) {
-        wstring absolute_file_name = (wstring)(path(extract_dir) / path(file_info.relative_file_name));
+    if (!decompressFiles(archive_file, archive_name, extract_dir, selected)) return false;
 
-        // update callback info
-        updateCallbackInfo(file_info, archive_name, extract_dir);
+    // files got their metadata before they were closed, directories are changed by files created in them
+    for (FileInfo* file_info : selected) {
+        if (file_info->file_header.flags & F_ISDIR) file_list->updateFile(*file_info, extract_dir);
+    }
+    if (!archive_callback->callback(CLT_ARCHIVE_FINISH)) return false;
+    return true;
+}
 
-        if (file_info.file_header.flags & F_ISDIR) {
+// decompress selected files on worker threads
+bool Archive::decompressFiles(MappedFile &archive_map, wstring &archive_name, wstring &extract_dir, vector<FileInfo*>& selected) {
+    // directories are created up front, workers only create files
+    QWord total_size = 0;
+    create_directories(toPath(extract_dir));
+    for (FileInfo* file_info : selected) {
+        path absolute_file_name = toPath(extract_dir) / toPath(file_info->relative_file_name);
+        if (file_info->file_header.flags & F_ISDIR) {
             create_directories(absolute_file_name);
         } else {
-            create_directories(path(absolute_file_name).parent_path());
-            ofstream ofile(absolute_file_name, ios::binary);
-            if (!decompressFile(archive_file, ofile, file_info)) return false;
+            create_directories(absolute_file_name.parent_path());
+            total_size += file_info->file_header.file_size;
         }
     }
-    file_list->updateFiles(extract_dir);
+
+    // largest jobs first, so one big file does not finish alone at the end
+    vector<DecompressJob> jobs;
+    createDecompressJobs(selected, jobs);
+    sort(jobs.begin(), jobs.end(), [](DecompressJob& a, DecompressJob& b) {
+        return a.files[0]->file_header.file_compressed_size > b.files[0]->file_header.file_compressed_size;
+    });
+    QWord number_of_files = 0;
+    for (DecompressJob& job : jobs) number_of_files += job.files.size() + job.copies.size();
+
+    // finished files are reported from this thread, callbacks are not called by workers
+    struct FinishedFile {
+        FileInfo* file_info;
+        QWord     read_bytes;   // share of compressed data
+        bool      valid;
+    };
+    deque<FinishedFile> finished;
+    mutex               finished_mutex;
+    condition_variable  file_done;
+    atomic<QWord>       next_job(0), written_bytes(0);
+    atomic<bool>        cancelled(false);
+
+    // workers decode straight from mapped archive to own output files, memory is bounded by codec buffers
+    vector<thread> workers;
+    for (DWord t = 0; t < getThreadCount(); t++) {
+        workers.emplace_back([&]() {
+            CodecSet*       worker_codecs = createCodecs();
+            Hashing         worker_hashing;
+            unique_ptr<IOBackendInterface> io_backend(settings.io_queue_depth > 0 ? createIOBackend(settings.io_queue_depth) : nullptr);
+
+            for (QWord i = next_job++; i < jobs.size() && !cancelled; i = next_job++) {
+                DecompressJob& job = jobs[i];
+                vector<Byte> valid(job.files.size() + job.copies.size(), false);
+                decompressJob(archive_map, job, extract_dir, worker_codecs, &worker_hashing, io_backend.get(), written_bytes, valid);
+
+                // compressed size of solid group is split between its files
+                QWord job_size = streamPos(job.files.back()) + job.files.back()->file_header.file_size;
+
+                lock_guard<mutex> lock(finished_mutex);
+                for (QWord f = 0; f < job.files.size(); f++) {
+                    FileHeader& file_header = job.files[f]->file_header;
+                    QWord read_bytes = job_size > 0 ? file_header.file_compressed_size * file_header.file_size / job_size : 0;
+                    finished.push_back({ job.files[f], read_bytes, valid[f] != 0 });
+                }
+                for (QWord c = 0; c < job.copies.size(); c++) {
+                    finished.push_back({ job.copies[c], 0, valid[job.files.size() + c] != 0 });
+                }
+                file_done.notify_one();
+            }
+            delete worker_codecs;
+        });
+    }
+
+    // report progress and finished files
+    ArchiveCallbackInfo& info = archive_callback->info;
+    QWord   finished_files      = 0;
+    QWord   read_bytes          = 0;
+    clock_t archive_clock_start = clock();
+    bool    ok                  = true;
+    info.archive_read_bytes     = 0;
+    info.archive_written_bytes  = 0;
+
+    unique_lock<mutex> lock(finished_mutex);
+    while (finished_files < number_of_files && ok) {
+        file_done.wait_for(lock, chrono::milliseconds(100), [&] { return !finished.empty(); });
+        deque<FinishedFile> reported;
+        reported.swap(finished);
+        lock.unlock();
+
+        info.archive_written_bytes = written_bytes;
+        info.archive_precent       = COUNTPRECENT(info.archive_written_bytes, total_size > 0 ? total_size : 1);
+        info.archive_clock         = COUNTTIME(archive_clock_start);
+        info.file_clock            = info.archive_clock;
+
+        for (FinishedFile& file : reported) {
+            FileHeader& file_header = file.file_info->file_header;
+            finished_files++;
+            read_bytes += file.read_bytes;
+            updateCallbackInfo(*file.file_info, archive_name, extract_dir);
+            info.file_read_bytes    = file.read_bytes;
+            info.file_written_bytes = file_header.file_size;
+            info.file_ratio         = COUNTPRECENT(file.read_bytes, file_header.file_size > 0 ? file_header.file_size : 1);
+            info.file_precent       = 100;
+            info.archive_read_bytes = read_bytes;
+            info.archive_ratio      = COUNTPRECENT(read_bytes, info.archive_written_bytes > 0 ? info.archive_written_bytes : 1);
+
+            if (!file.valid) {
+                archive_callback->callback(CLT_FILE_CORRUPTED);
+                ok = false;
+            } else if (!archive_callback->callback(CLT_FILE_BEGIN) || !archive_callback->callback(CLT_FILE_FINISH)) {
+                ok = false;
+            }
+        }
+        if (ok && reported.empty()) ok = archive_callback->callback(CLT_PROGRESS);
+        lock.lock();
+    }
+    lock.unlock();
+
+    // stop handing out jobs after error or cancel
+    cancelled = !ok;
+    for (thread& worker : workers) worker.join();
+    return ok;
+}
+
+// verify archive without writing any output
+bool Archive::archiveVerify(wstring &archive_name) {
+    MappedFile archive_file;
+    if (!archive_file.open(archive_name.c_str())) return false;
+
+    // data is decoded from begin to end, kernel reads ahead while blocks are decoded
+    archive_file.adviseSequential();
+
+    // read header and file list
+    if (!readArchiveHeader(archive_file)) return false;
+    if (!readFileList(archive_file, *file_list)) return false;
+    vector<FileInfo>* list = file_list->getFileList();
+
+    // callbacks
+    archive_callback->info.callback_action = CLA_VERIFY;
+    archive_callback->info.number_of_files = file_list->getNumberOfFiles() + file_list->getNumberOfFolders();
+    if (!archive_callback->callback(CLT_ARCHIVE_BEGIN)) return false;
+
+    // file, solid group or data shared by duplicates
+    vector<FileInfo*> files;
+    for (FileInfo& file_info : *list) files.push_back(&file_info);
+    vector<DecompressJob> jobs, block_jobs, file_jobs;
+    createDecompressJobs(files, jobs);
+
+    // blocks can be checked independently only if they carry checksums, chunked files are decoded whole
+    for (DecompressJob& job : jobs) {
+        bool blocks = (archive_header.flags & AF_BLOCK_CHECKSUM) && !(job.files[0]->file_header.flags & F_CHUNKED);
+        (blocks ? block_jobs : file_jobs).push_back(move(job));
+    }
+    vector<Byte> corrupted(list->size(), false);
+    verifyBlocks(archive_file, *list, block_jobs, corrupted);
+    verifyFiles (archive_file, *list, file_jobs,  corrupted);
+
+    // report broken files
+    bool valid = true;
+    wstring no_output;
+    for (QWord i = 0; i < list->size(); i++) {
+        if (!corrupted[i]) continue;
+        valid = false;
+        updateCallbackInfo((*list)[i], archive_name, no_output);
+        archive_callback->callback(CLT_FILE_CORRUPTED);
+    }
+
     if (!archive_callback->callback(CLT_ARCHIVE_FINISH)) return false;
+    return valid;
+}
+
+// reader walks block framing, workers decode and check block checksums
+void Archive::verifyBlocks(MappedFile &archive_map, vector<FileInfo>& list, vector<DecompressJob>& jobs, vector<Byte>& corrupted) {
+    struct VerifyJob {
+        QWord        job_index;
+        CodecChoice  codec;
+        vector<Byte> block;
+    };
+
+    WorkQueue<VerifyJob> queue(getThreadCount() * 4);
+    vector<QWord> decoded_size(jobs.size(), 0);
+    vector<Byte>  corrupted_job(jobs.size(), false);
+    mutex result_mutex;
+
+    // workers
+    vector<thread> workers;
+    for (DWord t = 0; t < getThreadCount(); t++) {
+        workers.emplace_back([&]() {
+            CodecSet* worker_codecs = createCodecs();
+            VerifyJob job;
+            while (queue.pop(job)) {
+                CodecInterface*   worker_codec = worker_codecs->get(job.codec);
+                MemoryInputStream input(job.block.data(), job.block.size());
+                NullOutputStream  output;
+                worker_codec->decompressStream(&input, &output);
+
+                lock_guard<mutex> lock(result_mutex);
+                decoded_size[job.job_index] += output.getSize();
+                if (worker_codec->isCorrupted()) corrupted_job[job.job_index] = true;
+            }
+            delete worker_codecs;
+        });
+    }
+
+    // reader, blocks of file with unknown codec can not be walked
+    CodecSet* reader_codecs = createCodecs();
+    QWord read_bytes = 0;
+    QWord data_size = archive_header.file_list_pos - sizeof(ArchiveHeader);
+    for (QWord j = 0; j < jobs.size(); j++) {
+        FileHeader&     file_header  = jobs[j].files[0]->file_header;
+        CodecInterface* reader_codec = reader_codecs->get(jobs[j].files[0]->codec);
+
+        MappedInputStream input(&archive_map, file_header.file_data_pos, file_header.file_compressed_size);
+        if (!reader_codec || input.getSize() < file_header.file_compressed_size) {
+            lock_guard<mutex> lock(result_mutex);
+            corrupted_job[j] = true;
+        }
+        while (reader_codec && input.getPos() < input.getSize()) {
+            VerifyJob job;
+            job.job_index = j;
+            job.codec     = jobs[j].files[0]->codec;
+            if (!reader_codec->readBlock(&input, job.block)) {
+                lock_guard<mutex> lock(result_mutex);
+                corrupted_job[j] = true;
+                break;
+            }
+            queue.push(move(job));
+        }
+        read_bytes += file_header.file_compressed_size;
+
+        // progress
+        archive_callback->info.archive_read_bytes = read_bytes;
+        archive_callback->info.archive_precent    = COUNTPRECENT(read_bytes, data_size > 0 ? data_size : 1);
+        if (!archive_callback->callback(CLT_PROGRESS)) break;
+    }
+    queue.close();
+    for (thread& worker : workers) worker.join();
+    delete reader_codecs;
+
+    // broken or truncated data marks all files sharing it, solid group can be longer than its files
+    // if archiveAppend replaced some of them
+    for (QWord j = 0; j < jobs.size(); j++) {
+        QWord end = 0;
+        for (FileInfo* file_info : jobs[j].files) end = max(end, streamPos(file_info) + file_info->file_header.file_size);
+        bool solid  = (jobs[j].files[0]->file_header.flags & F_SOLID) != 0;
+        bool broken = corrupted_job[j] || (solid ? decoded_size[j] < end : decoded_size[j] != end);
+        if (!broken) continue;
+        for (FileInfo* file_info : jobs[j].files)  corrupted[file_info - list.data()] = true;
+        for (FileInfo* file_info : jobs[j].copies) corrupted[file_info - list.data()] = true;
+    }
+}
+
+// archives without block checksums are verified file by file with file hash
+void Archive::verifyFiles(MappedFile &archive_map, vector<FileInfo>& list, vector<DecompressJob>& jobs, vector<Byte>& corrupted) {
+    atomic<QWord> next_job(0), written_bytes(0);
+    wstring no_output;
+
+    vector<thread> workers;
+    for (DWord t = 0; t < getThreadCount(); t++) {
+        workers.emplace_back([&]() {
+            CodecSet*       worker_codecs = createCodecs();
+            Hashing         worker_hashing;
+
+            for (QWord i = next_job++; i < jobs.size(); i = next_job++) {
+                DecompressJob& job = jobs[i];
+                vector<Byte> valid(job.files.size() + job.copies.size(), false);
+                decompressJob(archive_map, job, no_output, worker_codecs, &worker_hashing, nullptr, written_bytes, valid);
+                for (QWord f = 0; f < job.files.size(); f++)  corrupted[job.files[f]  - list.data()] = !valid[f];
+                for (QWord c = 0; c < job.copies.size(); c++) corrupted[job.copies[c] - list.data()] = !valid[job.files.size() + c];
+            }
+            delete worker_codecs;
+        });
+    }
+    for (thread& worker : workers) worker.join();
+}
+
+// open archive for random access reads
+bool Archive::archiveOpen(wstring &archive_name) {
+    archiveClose();
+    // read header and file list
+    if (!archive_map.open(archive_name.c_str()) || !readArchiveHeader(archive_map)) {
+        archiveClose();
+        return false;
+    }
+    if (!readFileList(archive_map, *file_list)) {
+        archiveClose();
+        return false;
+    }
+
+    read_codecs = createCodecs();
     return true;
 }
 
+void Archive::archiveClose() {
+    archive_map.close();
+    if (read_codecs) delete read_codecs;
+    read_codecs = nullptr;
+}
+
+vector<FileInfo>* Archive::getFileList() {
+    return file_list->getFileList();
+}
+
+// read part of file from opened archive
+QWord Archive::readAt(FileInfo &file_info, QWord offset, Byte *buf, QWord length) {
+    FileHeader&     file_header = file_info.file_header;
+    CodecInterface* read_codec  = read_codecs ? read_codecs->get(file_info.codec) : nullptr;
+    if (!read_codec || (file_header.flags & F_ISDIR) || offset >= file_header.file_size) return 0;
+    if (length > file_header.file_size - offset) length = file_header.file_size - offset;
+
+    // chunked file - decode chunks covering the range, wherever they are stored
+    if (file_header.flags & F_CHUNKED) {
+        vector<ChunkPosition>& chunk_list = file_info.chunk_list;
+        auto chunk = upper_bound(chunk_list.begin(), chunk_list.end(), offset,
+            [](QWord in_pos, const ChunkPosition& chunk_pos) { return in_pos < chunk_pos.in_pos; });
+        if (chunk == chunk_list.begin()) return 0;
+        chunk--;
+
+        MemoryOutputStream memory_output(buf, length);
+        SkipOutputStream   output(&memory_output, offset - chunk->in_pos);
+        for (; chunk != chunk_list.end() && chunk->in_pos < offset + length; chunk++) {
+            MappedInputStream input(&archive_map, chunk->out_pos, chunk->compressed_size);
+            read_codec->decompressStream(&input, &output);
+            if (read_codec->isCorrupted()) return 0;
+        }
+        return memory_output.getPos();
+    }
+
+    // file of solid group starts inside group data, which has no seek table
+    if (file_header.flags & F_SOLID) offset += file_header.file_solid_pos;
+
+    // last block starting at or before offset, first block starting after the range
+    vector<BlockPosition>& seek_table = file_info.seek_table;
+    QWord in_begin = 0, out_begin = 0, out_end = file_header.file_compressed_size;
+    auto first = upper_bound(seek_table.begin(), seek_table.end(), offset,
+        [](QWord in_pos, const BlockPosition& block_pos) { return in_pos < block_pos.in_pos; });
+    if (first != seek_table.begin()) {
+        in_begin  = (first - 1)->in_pos;
+        out_begin = (first - 1)->out_pos;
+    }
+    auto last = lower_bound(first, seek_table.end(), offset + length,
+        [](const BlockPosition& block_pos, QWord in_pos) { return block_pos.in_pos < in_pos; });
+    if (last != seek_table.end()) out_end = last->out_pos;
+
+    // decode covering blocks only
+    MappedInputStream   input(&archive_map, file_header.file_data_pos + out_begin, out_end - out_begin);
+    MemoryOutputStream  memory_output(buf, length);
+    SkipOutputStream    output(&memory_output, offset - in_begin);
+    read_codec->decompressStream(&input, &output);
+
+    if (read_codec->isCorrupted()) return 0;
+    return memory_output.getPos();
+}
+
 // detect if input is a file, folder or archive 
 ArchiveDetectResult Archive::detectInput(wstring &input_name) {
     memset(&archive_header, 0, sizeof(ArchiveHeader));
-    if (is_directory(input_name)) {
+    if (is_directory(toPath(input_name))) {
         // input is directory to compress
         return AD_CREATE;
 
-    } else if (is_regular_file(input_name)) {
+    } else if (is_regular_file(toPath(input_name))) {
         // try to read header
-        ifstream ifile(input_name, ios::binary);
+        ifstream ifile(toPath(input_name), ios::binary);
         bool is_arch = false;
         if (ifile.is_open()) {
             is_arch = readArchiveHeader(ifile);
@@ -17,6 +17,12 @@
 #include <string>
 #include <memory>
 #include <vector>
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <chrono>
 
 // c
 #include <cassert>
@@ -26,19 +32,28 @@
 #include "Types.h"
 #include "Utils.h"
 #include "LZHuffman.h"
+#include "Codecs.h"
 #include "Hashing.h"
 #include "FileList.h"
+#include "WorkQueue.h"
+#include "IOBackend.h"
 
 using namespace std;
 
 namespace SCL {
 
+// scanned entries waiting for input stage of streaming pipeline, jobs between input stage and writer
+const QWord  STREAM_QUEUE_SIZE = 0x1000;
+const QWord  STREAM_JOB_COUNT  = 0x200;
+
 // archive header signature
 const Byte   SCL_ARCHIVE_SIGNATURE0[4] = { 'L', 'Z', 'H', 'X' };
 const DWord  SCL_ARCHIVE_SIGNATURE1    = 0x7FFFFFFF;
 
 // enums
 enum ArchiveDetectResult    { AD_UNKNOWN = 100, AD_CREATE  = 101, AD_EXTRACT = 102 };
+enum ArchiveFlags           { AF_BLOCK_CHECKSUM = 1, AF_COMPACT_LIST = 2, AF_COMPACT_BLOCKS = 4 };
+enum SolidOrder             { SO_LIST = 0, SO_NAME = 1, SO_CONTENT = 2 };
 
 // archive header
 struct ArchiveHeader {
@@ -47,6 +62,114 @@ struct ArchiveHeader {
     DWord flags;
     QWord file_list_pos;
 };
+
+// archive settings
+struct ArchiveSettings {
+    bool  block_checksum;   // store checksum in every codec block
+    bool  compact_blocks;   // codec blocks with flags byte and varint sizes, QWord sizes otherwise
+    bool  seek_table;       // store codec block positions of files for random access reads
+    DWord threads;          // number of worker threads, 0 - one per core
+    QWord spill_size;       // larger files are compressed to temporary files instead of memory
+    QWord solid_size;       // smaller files are compressed together in groups of this size, 0 - off
+    SolidOrder solid_order; // order of files in solid groups - list, extension and name, or content similarity
+    bool  dedup;            // identical files are stored once
+    bool  hard_links;       // duplicates are extracted as hard links if possible, copies otherwise
+    bool  chunk_dedup;      // large files are cut into content-defined chunks stored once per archive
+    DWord io_queue_depth;   // small files are read and written in batches of this many by I/O backend, 0 - off
+    QWord pipeline_memory;  // files are compressed while scanned, file data and compressed data held by pipeline, 0 - scan first
+    CodecPolicy codec_policy;   // codec of file not in solid group or chunked, nullptr - default codec for all files
+};
+
+// streaming pipeline stages of last created archive
+struct PipelineStats {
+    QueueStats scan;        // entries found by scanner, waiting for input stage
+    QueueStats read;        // jobs read by input stage, waiting for workers
+    QueueStats compress;    // jobs compressed by workers, waiting for writer
+    QWord      max_memory;  // largest file data and compressed data held at once
+};
+
+// file or solid group of files compressed by worker thread, waiting for archive writer
+struct CompressJob {
+    vector<QWord> files;            // positions in file list, more than one for solid group
+    QWord         input_size;
+    QWord         compressed_size;
+    vector<Byte>  data;             // compressed data kept in memory
+    wstring       spill_name;       // temporary file with compressed data of large file
+    vector<pair<QWord, QWord>> duplicates;  // duplicate and its original file, stored with this job
+    vector<QWord> chunk_ids;        // chunks of chunked file, located in archive after all jobs are written
+    QWord         data_pos;         // position in archive, set by writer
+    vector<Byte>  input;            // data of small files read ahead by input stage
+    bool          preload;          // job is read by input stage, not by worker
+    bool          loaded;
+    bool          done;
+    vector<FileInfo> entries;       // streamed entries up to file of job, put to file list by writer
+    bool          dedup;            // streamed file shares size with earlier file
+    string        digest;           // its strong hash, empty if file could not be read whole
+    QWord         first_file;       // first file of that size, hashed with second one
+    wstring       first_name;
+};
+
+// chunk stored by one of compression jobs
+struct ChunkLocation {
+    QWord job;
+    QWord out_pos;                  // position in job data
+    QWord compressed_size;
+};
+
+// chunks of all files in archive by strong hash, shared by worker threads
+struct ChunkIndex {
+    mutex                        index_mutex;
+    unordered_map<string, QWord> ids;
+    vector<ChunkLocation>        locations;
+};
+
+// strong hashes of streamed files, first file in list order is original of identical files
+struct DedupIndex {
+    mutex                        index_mutex;
+    unordered_map<string, QWord> originals;
+};
+
+// range of previous archive copied to updated archive
+struct CopiedRange {
+    QWord old_begin;
+    QWord old_end;
+    QWord new_begin;
+};
+
+// file, solid group or data shared by duplicates, decompressed once
+struct DecompressJob {
+    vector<FileInfo*> files;        // in order of decompressed data
+    vector<FileInfo*> copies;       // duplicates of files, copied after decompression
+    vector<QWord>     sources;      // position of copied file in files
+};
+
+// splits decompressed file or solid group into its files, checks hash of every file
+class SplitOutputStream : public OutputStreamInterface {
+private:
+    vector<FileInfo*>& files;       // in order of decompressed data
+    vector<Byte>&      valid;
+    wstring&           extract_dir; // files are only hashed if empty
+    HashingInterface*  hashing;
+    atomic<QWord>*     counter;
+    FileHandle         ofile;       // times and attributes are set through it before it is closed
+    bool               written;     // file was created and all its data written
+    QWord              current;
+    bool               started;
+    IOBackendInterface*  io_backend;    // small files are kept in memory and written in batches
+    DWord                batch_size;
+    vector<vector<Byte>> batch_data;
+    vector<QWord>        batch_files;
+    void  beginFile();
+    void  finishFile(bool complete);
+    void  writeBatch();
+public:
+    SplitOutputStream(vector<FileInfo*>& files, vector<Byte>& valid, wstring& extract_dir,
+                      HashingInterface* hashing, atomic<QWord>* counter,
+                      IOBackendInterface* io_backend = nullptr, DWord batch_size = 0);
+    virtual bool write(Byte* buf, QWord size);
+    void finish();  // files not reached by decompressed data are invalid
+};
+
 // callback structure
 struct ArchiveCallbackInfo {
     int            file_ratio;
@@ -106,18 +229,67 @@ private:
     HashingInterface          *hashing;
     FileList                  *file_list;
     ArchiveHeader              archive_header;
+    ArchiveSettings            settings;
+    PipelineStats              pipeline_stats;
+
+    // archive opened for random access reads
+    MappedFile                 archive_map;
+    CodecSet                  *read_codecs;
+
+    // codec instance for file list, codecs of files for worker threads
+    CodecInterface* createCodec();
+    CodecSet*       createCodecs();
+    BlockFormat     getBlockFormat();
+    DWord getThreadCount();
+
+
+    // compress/decompress file or solid group
+    void compressJob  (CompressJob& job, QWord job_index, CodecSet* worker_codecs, HashingInterface* worker_hashing,
+                       ChunkIndex& chunk_index, atomic<QWord>& read_bytes);
+    QWord compressChunks(FileInfo& file_info, CompressJob& job, QWord job_index, OutputStreamInterface* output,
+                         CodecInterface* worker_codec, HashingInterface* worker_hashing, ChunkIndex& chunk_index,
+                         atomic<QWord>& read_bytes);
+    void decompressJob(MappedFile &archive_map, DecompressJob& job, wstring &extract_dir, CodecSet* worker_codecs,
+                       HashingInterface* worker_hashing, IOBackendInterface* io_backend, atomic<QWord>& written_bytes,
+                       vector<Byte>& valid);
+    void createCompressJobs  (wstring &archive_name, vector<Byte>& reused, vector<CompressJob>& jobs);
+    void createDecompressJobs(vector<FileInfo*>& files, vector<DecompressJob>& jobs);
+
+    // compress files on worker threads, write them to archive in job order, reused files are skipped
+    bool compressFiles     (ofstream &archive_file, wstring &archive_name, vector<Byte>& reused);
+    bool writeCompressedJob(ofstream &archive_file, CompressJob& job);
+    bool reportWrittenJob  (CompressJob& job, wstring &archive_name, wstring &out_dir, QWord& finished_bytes, QWord total_size,
+                            clock_t archive_clock_start);
+
+    // compress files while they are scanned, scanner -> input stage -> workers -> writer
+    bool streamFiles(ofstream &archive_file, wstring &archive_name);
+
+    // create file list reporting counting progress
+    bool scanFiles(vector<wstring> &files);
+
+    // copy compressed data of files unchanged since previous archive
+    bool copyUnchangedFiles(MappedFile &old_archive, ofstream &archive_file, FileList &old_list, vector<Byte>& reused);
 
-    // compress/decompress file
-    bool compressFile  (ifstream &ifile, ofstream &ofile, FileInfo& file_info);
-    bool decompressFile(ifstream &ifile, ofstream &ofile, FileInfo& file_info);
+    // decompress selected files on worker threads, all reading mapped archive
+    bool decompressFiles(MappedFile &archive_map, wstring &archive_name, wstring &extract_dir, vector<FileInfo*>& selected);
+
+    // parallel verification
+    void verifyBlocks(MappedFile &archive_map, vector<FileInfo>& list, vector<DecompressJob>& jobs, vector<Byte>& corrupted);
+    void verifyFiles (MappedFile &archive_map, vector<FileInfo>& list, vector<DecompressJob>& jobs, vector<Byte>& corrupted);
     
     // read/write archive header
     void writeArchiveHeader(ofstream& ofile);
     bool readArchiveHeader (ifstream& ifile);
+    bool readArchiveHeader (MappedFile& archive_map);
+
+    // read/write directory at file_list_pos
+    void writeFileList(ofstream& ofile);
+    bool readFileList (MappedFile& archive_map, FileList& list);
     
     // update callback
     void updateCallbackInfo(FileInfo &file_info, wstring& archive_name, wstring& output_path);
     void updateCallbackInfo(FileInfo& file_info);
+    void updateCallbackNames(const wstring& relative_file_name, wstring& archive_name, wstring& output_path);
 
 public:
     Archive();
@@ -126,12 +298,38 @@ public:
     // set callback
     void setCallback(ArchiveCallbackInterface *archive_callback);
 
+    // settings used by archiveCreate
+    ArchiveSettings* getSettings();
+
+    // queue depths and memory of streaming pipeline used by last archiveCreate
+    PipelineStats* getPipelineStats();
+
     // create archive from directory or file
     bool archiveCreate(vector<wstring> &files, wstring &archive_name);
 
+    // recreate archive from directory or file, compresses only files changed since archive was created
+    bool archiveUpdate(vector<wstring> &files, wstring &archive_name);
+
+    // add new and changed files at end of archive, followed by directory replacing previous one
+    bool archiveAppend(vector<wstring> &files, wstring &archive_name);
+
     // archive extracting function
     bool archiveExtract(wstring &archive_name, wstring &extract_dir);
 
+    // extract only files matching names or wildcard patterns (directories are extracted with content)
+    bool archiveExtract(wstring &archive_name, wstring &extract_dir, vector<wstring> &patterns);
+
+    // check all blocks/files of archive without writing output
+    bool archiveVerify(wstring &archive_name);
+
+    // open archive for random access reads
+    bool archiveOpen(wstring &archive_name);
+    void archiveClose();
+    vector<FileInfo>* getFileList();
+
+    // read part of file from opened archive, decodes only blocks covering the range
+    QWord readAt(FileInfo &file_info, QWord offset, Byte *buf, QWord length);
+
     // detect if input is a file, folder or archive 
     ArchiveDetectResult detectInput(wstring &input_name);
 };
@@ -10,15 +10,16 @@
 using namespace SCL;
 
 // constructor/destructors
-BitStream::BitStream()                  { this->buf = nullptr; resetPos(); }
-void BitStream::assignBuffer(Byte *b)   { this->buf = b;       resetPos(); }
+BitStream::BitStream()                      { this->buf = nullptr; this->size = INT_MAX; resetPos(); }
+void BitStream::assignBuffer(Byte *b, int s) { this->buf = b;       this->size = s;       resetPos(); }
+bool BitStream::isOverrun()                  { return overrun; }
 
 // positioning
 int  BitStream::getBitPos ()  { return bit_pos;  }
 int  BitStream::getBytePos()  { return byte_pos; }
 void BitStream::setBitPos (int bp ) { this->bit_pos = bp; }
 void BitStream::setBytePos(int bp) { this->byte_pos = bp; }
-void BitStream::resetPos() { bit_pos = byte_pos = 0; }
+void BitStream::resetPos() { bit_pos = byte_pos = 0; overrun = false; }
 
 // writing
 void BitStream::writeBit(int bit) {
@@ -33,13 +34,14 @@ void BitStream::writeBits(int bits, int count) {
 
 // reading
 int BitStream::readBit() {
+	if (byte_pos >= size) { overrun = true; return -1; }
 	int ret = (buf[byte_pos] >> bit_pos++) & 1;
 	if (bit_pos > 7) { bit_pos = 0; byte_pos++; }
 	return ret;
 }
 int BitStream::readBits(int count) {
 	int bits = 0;
-	if (count == 8 && bit_pos == 0) { bits = buf[byte_pos++]; }
-	else { for (int i = 0; i < count; i++) { bits |= readBit() << i; } }
+	if (count == 8 && bit_pos == 0 && byte_pos < size) { bits = buf[byte_pos++]; }
+	else { for (int i = 0; i < count && !overrun; i++) { bits |= (readBit() & 1) << i; } }
 	return bits;
 }
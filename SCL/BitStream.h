@@ -8,6 +8,9 @@
 #ifndef SCL_BITSTREAM_H
 #define SCL_BITSTREAM_H
 
+// C
+#include <climits>
+
 #include "Types.h"
 
 namespace SCL {
@@ -16,10 +19,13 @@ namespace SCL {
 class BitStream {
 private:
     Byte *buf;
-	int bit_pos, byte_pos;
+	int bit_pos, byte_pos, size;
+	bool overrun;
 public:
 	BitStream();
-	void assignBuffer(Byte *buf);
+	// reading stops at size bytes - buffer can be borrowed memory with nothing behind it
+	void assignBuffer(Byte *buf, int size = INT_MAX);
+	bool isOverrun();
     // pos
 	int  getBitPos();
 	int  getBytePos();
@@ -0,0 +1,136 @@
+////////////////////////////////////////////
+// Small Compression Library              //
+// author: Mariusz Ziach                  //
+// www   : http://ziach.pl/               //
+// date  : 2020                           //
+////////////////////////////////////////////
+
+// C++
+#include <filesystem>
+#include <cwctype>
+
+// Archive
+#include "Codecs.h"
+
+namespace SCL {
+
+bool CodecChoice::isDefault() const {
+    return id == CID_LZHUFFMAN && level == LCL_NORMAL;
+}
+
+// extensions of files chosen by name
+static const wchar_t* media_extensions[] = {
+    L"jpg", L"jpeg", L"png", L"gif", L"webp", L"heic", L"mp3", L"m4a", L"ogg", L"opus", L"flac",
+    L"mp4", L"m4v", L"mkv", L"avi", L"mov", L"webm", L"zip", L"gz", L"tgz", L"bz2", L"xz", L"7z",
+    L"rar", L"zst", L"lz4", L"scla", L"jar", L"apk", L"docx", L"xlsx", L"pptx"
+};
+
+static const wchar_t* source_extensions[] = {
+    L"c", L"cc", L"cpp", L"cxx", L"h", L"hh", L"hpp", L"hxx", L"inl", L"cs", L"java", L"kt", L"scala",
+    L"py", L"rb", L"js", L"ts", L"go", L"rs", L"swift", L"m", L"mm", L"php", L"pl", L"lua", L"sh"
+};
+
+template <size_t N>
+static bool hasExtension(const wstring& extension, const wchar_t* (&extensions)[N]) {
+    for (const wchar_t* known : extensions) {
+        if (extension == known) return true;
+    }
+    return false;
+}
+
+QWord sampleWindowPos(QWord file_size, DWord window) {
+    if (file_size <= CODEC_SAMPLE_WINDOWS * CODEC_SAMPLE_SIZE) return window * CODEC_SAMPLE_SIZE;
+    return (file_size - CODEC_SAMPLE_SIZE) / (CODEC_SAMPLE_WINDOWS - 1) * window;
+}
+
+// compressed size of whole sample, codecs of policy are kept by each thread calling it
+static QWord sampleCompressedSize(const CodecChoice& choice, Byte* sample, QWord sample_size) {
+    static thread_local CodecSet sample_codecs(false, BF_COMPACT);
+    CodecInterface* codec = sample_codecs.get(choice);
+    vector<Byte> compressed;
+    MemoryInputStream  input(sample, sample_size);
+    BufferOutputStream output(&compressed);
+    codec->compressStream(&input, &output);
+    return compressed.size();
+}
+
+CodecChoice selectCodec(const wstring& file_name, QWord file_size, Byte* sample, QWord sample_size) {
+    CodecChoice choice;
+
+    // extension without dot, lower case
+    wstring extension = fromPath(toPath(file_name).extension());
+    if (!extension.empty()) extension.erase(0, 1);
+    for (wchar_t& wc : extension) wc = (wchar_t)towlower(wc);
+
+    // other codec is taken only if sample shows default one is not better, codec of file takes space in list,
+    // so small source files whole in sample keep default level
+    CodecChoice other;
+    if (hasExtension(extension, media_extensions)) {
+        other.id = CID_STORE;
+        if (sample_size > 0 && sampleCompressedSize(choice, sample, sample_size) >= sample_size) choice = other;
+    } else if (hasExtension(extension, source_extensions) && file_size > sample_size) {
+        other.level = LCL_BEST;
+        if (sampleCompressedSize(other, sample, sample_size) < sampleCompressedSize(choice, sample, sample_size)) choice = other;
+    } else if (extension == L"log" && file_size >= CODEC_LARGE_LOG) {
+        other.level = LCL_FASTEST;
+        if (sampleCompressedSize(other, sample, sample_size) <= sampleCompressedSize(choice, sample, sample_size)) choice = other;
+    }
+    return choice;
+}
+
+// built-in codecs
+static CodecInterface* createLZHuffman(LZCompressionLevel level) { return new LZHuffman(level); }
+static CodecInterface* createStore    (LZCompressionLevel) { return new Store; }
+static CodecInterface* createLZ       (LZCompressionLevel level) { return new LZ(level); }
+static CodecInterface* createLZFast   (LZCompressionLevel) { return new LZFast; }
+
+CodecRegistry::CodecRegistry() {
+    factories[CID_LZHUFFMAN] = createLZHuffman;
+    factories[CID_STORE]     = createStore;
+    factories[CID_LZ]        = createLZ;
+    factories[CID_LZFAST]    = createLZFast;
+}
+
+CodecRegistry& CodecRegistry::get() {
+    static CodecRegistry registry;
+    return registry;
+}
+
+bool CodecRegistry::add(Byte id, CodecFactory factory) {
+    CodecRegistry& registry = get();
+    lock_guard<mutex> lock(registry.registry_mutex);
+    return registry.factories.emplace(id, factory).second;
+}
+
+CodecInterface* CodecRegistry::create(const CodecChoice& choice) {
+    if (choice.level < LCL_FASTEST || choice.level > LCL_BEST) return nullptr;
+    CodecRegistry& registry = get();
+    CodecFactory factory;
+    {
+        lock_guard<mutex> lock(registry.registry_mutex);
+        auto entry = registry.factories.find(choice.id);
+        if (entry == registry.factories.end()) return nullptr;
+        factory = entry->second;
+    }
+    return factory((LZCompressionLevel)choice.level);
+}
+
+// codec set
+CodecSet::CodecSet(bool block_checksum, BlockFormat block_format) {
+    this->block_checksum = block_checksum;
+    this->block_format   = block_format;
+}
+
+CodecInterface* CodecSet::get(const CodecChoice& choice) {
+    for (auto& codec : codecs) {
+        if (codec.first.id == choice.id && codec.first.level == choice.level) return codec.second.get();
+    }
+    CodecInterface* codec = CodecRegistry::create(choice);
+    if (!codec) return nullptr;
+    codec->setBlockChecksum(block_checksum);
+    codec->setBlockFormat(block_format);
+    codecs.emplace_back(choice, unique_ptr<CodecInterface>(codec));
+    return codec;
+}
+
+} // namespace
@@ -0,0 +1,81 @@
+////////////////////////////////////////////
+// Small Compression Library              //
+// author: Mariusz Ziach                  //
+// www   : http://ziach.pl/               //
+// date  : 2020                           //
+////////////////////////////////////////////
+
+#ifndef SCL_CODECS_H
+#define SCL_CODECS_H
+
+// C++
+#include <mutex>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Archive
+#include "Types.h"
+#include "LZ.h"
+#include "LZHuffman.h"
+#include "LZFast.h"
+#include "Store.h"
+
+namespace SCL {
+
+// codec IDs stored in archives, ID once given to codec is never reused
+enum CodecID { CID_LZHUFFMAN = 0, CID_STORE = 1, CID_LZ = 2, CID_LZFAST = 3 };
+
+// codec policy gets windows of file spread from its start to its end
+const QWord CODEC_SAMPLE_SIZE    = 0x1000;     // bytes of one window
+const DWord CODEC_SAMPLE_WINDOWS = 4;
+
+// larger logs can be compressed at fastest level
+const QWord CODEC_LARGE_LOG = 0x1000000;
+
+// codec of file and its level, default one is not stored with file
+struct CodecChoice {
+    Byte id    = CID_LZHUFFMAN;
+    Byte level = LCL_NORMAL;
+    bool isDefault() const;
+};
+
+// position of sample window in file, windows of small file follow each other
+QWord sampleWindowPos(QWord file_size, DWord window);
+
+// codec of file chosen from its name, size and sample windows (sample_size can be smaller than all windows)
+typedef CodecChoice (*CodecPolicy)(const wstring& file_name, QWord file_size, Byte* sample, QWord sample_size);
+
+// media stored if sample can not be compressed, source code larger than sample best and large logs fastest
+// if sample is compressed not worse than by default codec, the rest default
+CodecChoice selectCodec(const wstring& file_name, QWord file_size, Byte* sample, QWord sample_size);
+
+// new codec at given level
+typedef CodecInterface* (*CodecFactory)(LZCompressionLevel level);
+
+// codecs by ID, built-in ones are registered first
+class CodecRegistry {
+private:
+    mutex                             registry_mutex;
+    unordered_map<Byte, CodecFactory> factories;
+    CodecRegistry();
+    static CodecRegistry& get();
+public:
+    static bool add(Byte id, CodecFactory factory);         // false if ID is taken
+    static CodecInterface* create(const CodecChoice& choice);   // nullptr for unknown ID or level
+};
+
+// codecs used by one thread, created on first use
+class CodecSet {
+private:
+    bool block_checksum;
+    BlockFormat block_format;
+    vector<pair<CodecChoice, unique_ptr<CodecInterface>>> codecs;
+public:
+    CodecSet(bool block_checksum, BlockFormat block_format);
+    CodecInterface* get(const CodecChoice& choice);         // nullptr for unknown ID or level
+};
+
+} // namespace
+
+#endif // SCL_CODECS_H
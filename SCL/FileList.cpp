@@ -13,110 +13,703 @@ FileList::FileList() {
     number_of_files   = 0;
     number_of_folders = 0;
     size_of_all_files = 0;
+    scan_threads      = 1;
+    scanned           = 0;
     setlocale(LC_ALL, "");
 }
 
-FileList::~FileList() {}
-
-void FileList::insertFile(wstring &absolute_file_name, wstring &relative_file_name, QWord &file_ID) {
+// scan still running stops passing entries, it uses members of list until it finishes
+FileList::~FileList() {
+    closeStream();
+    if (thread_future.valid()) thread_future.wait();
+}
 
-    if (!is_regular_file(absolute_file_name) && !is_directory(absolute_file_name)) return;
+// file type is cached by directory iterator, the rest of metadata is read by one system call
+static bool createFileInfo(const directory_entry& entry, const wstring& relative_file_name, FileInfo& fi) {
+    error_code ec;
+    bool dir = entry.is_directory(ec);
+    if (!dir && !entry.is_regular_file(ec)) return false;
 
-    FileInfo fi;
-    fi.absolute_file_name = absolute_file_name;
+    fi.absolute_file_name = fromPath(entry.path());
     fi.relative_file_name = relative_file_name;
+    FileMetadata metadata;
+    if (!getFileMetadata(fi.absolute_file_name.c_str(), &metadata)) return false;
 
     memset(&fi.file_header, 0, sizeof(FileHeader));
 
-    fi.file_header.flags = is_directory(absolute_file_name) ? F_ISDIR : 0;
-    fi.file_header.file_size = file_size(fi.absolute_file_name);
+    fi.file_header.flags = dir ? F_ISDIR : 0;
+    fi.file_header.file_size = metadata.size;
     fi.file_header.file_name_length = (Word)fi.relative_file_name.length();
+    fi.file_header.file_creation_time     = metadata.creation_time;
+    fi.file_header.file_access_time       = metadata.access_time;
+    fi.file_header.file_modification_time = metadata.modification_time;
+    fi.file_header.file_attributes        = metadata.attributes;
+    return true;
+}
+
+void FileList::insertFile(FileInfo& fi, QWord& file_ID) {
     fi.file_header.file_ID = file_ID++;
+    if (fi.file_header.flags & F_ISDIR) {
+        number_of_folders++;
+    } else {
+        size_of_all_files += fi.file_header.file_size;
+        number_of_files++;
+    }
+    file_list.push_back(move(fi));
+}
 
-    getFileTime(fi.absolute_file_name.c_str(),
-        &fi.file_header.file_creation_time,
-        &fi.file_header.file_access_time,
-        &fi.file_header.file_modification_time);
+// directory listed by one thread, its subdirectories can be listed by any thread
+struct ScanDirectory {
+    path             dir;
+    wstring          relative_dir;
+    vector<FileInfo> entries;
+    vector<QWord>    subdirectories;    // directory listing every entry, NO_DIRECTORY for files
+    bool             listed;
+};
+
+const QWord NO_DIRECTORY = (QWord)-1;
+
+// work-stealing tree walker, every thread lists directories from its own queue, newest first,
+// and steals oldest directories from other threads when its queue is empty, listed directories can be merged meanwhile
+class DirectoryScanner {
+private:
+    deque<ScanDirectory> directories;   // references stay valid while it grows
+    mutex                directories_mutex;
+    vector<deque<QWord>> queues;
+    vector<mutex>        queue_mutexes;
+    mutex                wakeup_mutex;
+    condition_variable   wakeup, directory_listed;
+    QWord                queued;        // directories waiting in queues
+    QWord                pending;       // directories not listed yet
+    atomic<QWord>&       scanned;
+
+    bool takeDirectory(DWord thread, QWord& index) {
+        DWord threads = (DWord)queues.size();
+        for (DWord n = 0; n < threads; n++) {
+            DWord victim = (thread + n) % threads;
+            lock_guard<mutex> lock(queue_mutexes[victim]);
+            if (queues[victim].empty()) continue;
+            if (n == 0) {
+                index = queues[victim].back();
+                queues[victim].pop_back();
+            } else {
+                index = queues[victim].front();
+                queues[victim].pop_front();
+            }
+            lock_guard<mutex> wakeup_lock(wakeup_mutex);
+            queued--;
+            return true;
+        }
+        return false;
+    }
 
-    fi.file_header.file_attributes = getFileAttributes(fi.absolute_file_name.c_str());
+    void listDirectory(QWord index, DWord thread) {
+        ScanDirectory* directory;
+        {
+            lock_guard<mutex> lock(directories_mutex);
+            directory = &directories[index];
+        }
 
-    if (is_regular_file(absolute_file_name)) {
-        size_of_all_files += fi.file_header.file_size;
-        number_of_files++;
+        // unreadable directory is kept without content
+        error_code ec;
+        for (directory_iterator it(directory->dir, ec), end; !ec && it != end; it.increment(ec)) {
+            FileInfo fi;
+            if (!createFileInfo(*it, fromPath(toPath(directory->relative_dir) / it->path().filename()), fi)) continue;
+
+            // linked directories are not followed
+            error_code link_ec;
+            QWord subdirectory = NO_DIRECTORY;
+            if ((fi.file_header.flags & F_ISDIR) && !it->is_symlink(link_ec))
+                subdirectory = addDirectory(it->path(), fi.relative_file_name, thread);
+            directory->entries.push_back(move(fi));
+            directory->subdirectories.push_back(subdirectory);
+            scanned++;
+        }
     }
 
-    if (is_directory(absolute_file_name)) number_of_folders++;
+    void work(DWord thread) {
+        while (true) {
+            QWord index;
+            if (takeDirectory(thread, index)) {
+                listDirectory(index, thread);
+                lock_guard<mutex> lock(wakeup_mutex);
+                getDirectory(index).listed = true;
+                directory_listed.notify_all();
+                if (--pending == 0) wakeup.notify_all();
+                continue;
+            }
+            unique_lock<mutex> lock(wakeup_mutex);
+            if (pending == 0) return;
+            wakeup.wait(lock, [this] { return queued > 0 || pending == 0; });
+        }
+    }
 
-    file_list.push_back(fi);
-}
+public:
+    DirectoryScanner(atomic<QWord>& scanned, DWord threads)
+        : queues(threads ? threads : 1), queue_mutexes(threads ? threads : 1), scanned(scanned) {
+        queued  = 0;
+        pending = 0;
+    }
+
+    QWord addDirectory(const path& dir, const wstring& relative_dir, DWord thread) {
+        QWord index;
+        {
+            lock_guard<mutex> lock(directories_mutex);
+            index = directories.size();
+            directories.emplace_back();
+            directories.back().dir          = dir;
+            directories.back().relative_dir = relative_dir;
+            directories.back().listed       = false;
+        }
+        {
+            lock_guard<mutex> lock(wakeup_mutex);
+            queued++;
+            pending++;
+        }
+        {
+            lock_guard<mutex> lock(queue_mutexes[thread]);
+            queues[thread].push_back(index);
+        }
+        wakeup.notify_one();
+        return index;
+    }
+
+    // caller is first of threads
+    void run() {
+        vector<thread> workers;
+        for (DWord t = 1; t < queues.size(); t++) workers.emplace_back(&DirectoryScanner::work, this, t);
+        work(0);
+        for (thread& worker : workers) worker.join();
+    }
+
+    ScanDirectory& getDirectory(QWord index) {
+        lock_guard<mutex> lock(directories_mutex);
+        return directories[index];
+    }
+
+    // blocks until directory is listed by one of threads
+    ScanDirectory& waitDirectory(QWord index) {
+        unique_lock<mutex> lock(wakeup_mutex);
+        directory_listed.wait(lock, [&] { return getDirectory(index).listed; });
+        return getDirectory(index);
+    }
+};
 
 void FileList::createFileListThread() {
+    DirectoryScanner scanner(scanned, scan_threads);
+    vector<FileInfo> roots(file_names.size());
+    vector<QWord>    root_directories(file_names.size(), NO_DIRECTORY);
+    for (QWord i = 0; i < file_names.size(); i++) {
+        // absolute root gives absolute entries, root directory itself is not listed
+        error_code ec;
+        directory_entry root(absolute(toPath(file_names[i])), ec);
+        if (ec) continue;
+
+        if (root.is_directory(ec)) {
+            root_directories[i] = scanner.addDirectory(root.path(), fromPath(toPath(file_names[i]).filename()), 0);
+        } else if (createFileInfo(root, fromPath(root.path().filename()), roots[i])) {
+            scanned++;
+        }
+    }
+    thread scan(&DirectoryScanner::run, &scanner);
+
+    // same order as recursive directory iterator gives, directory is followed by its content,
+    // directories are merged as soon as they are listed
     QWord file_ID(0);
-    for (wstring& file_name : file_names) {
-        if (is_directory(file_name)) {
-            path item = file_name;
-            path dir_name = item.filename();
-            for (const auto& entry : recursive_directory_iterator(item)) {
-                wstring absolute_file_name = absolute(entry.path());
-                wstring relative_file_name = dir_name / entry.path().lexically_relative(item);
-                insertFile(absolute_file_name, relative_file_name, file_ID);
+    bool  ok = true;
+    for (QWord i = 0; i < file_names.size() && ok; i++) {
+        if (root_directories[i] == NO_DIRECTORY) {
+            if (!roots[i].absolute_file_name.empty()) ok = addEntry(roots[i], file_ID);
+            continue;
+        }
+        vector<pair<QWord, QWord>> stack = { { root_directories[i], 0 } };   // directory, next entry
+        while (!stack.empty() && ok) {
+            ScanDirectory& directory = scanner.waitDirectory(stack.back().first);
+            QWord entry = stack.back().second++;
+            if (entry == directory.entries.size()) {
+                stack.pop_back();
+                continue;
             }
-        } else if (is_regular_file(file_name)) {
-            wstring absolute_file_name = absolute(file_name);
-            wstring relative_file_name = path(absolute_file_name).filename();
-            insertFile(absolute_file_name, relative_file_name, file_ID);
+            QWord subdirectory = directory.subdirectories[entry];
+            ok = addEntry(directory.entries[entry], file_ID);
+            if (subdirectory != NO_DIRECTORY) stack.push_back({ subdirectory, 0 });
         }
     }
+    scan.join();
+    if (stream) stream->close();
 }
 
-QWord FileList::writeFileList(ofstream &ofs) {
-    streampos beg = ofs.tellp();
-    ofs.write((char*)&number_of_files,   sizeof(QWord));
-    ofs.write((char*)&number_of_folders, sizeof(QWord));
-    ofs.write((char*)&size_of_all_files, sizeof(QWord));
+// entry is passed to reader of stream if list is streamed
+bool FileList::addEntry(FileInfo& fi, QWord& file_ID) {
+    if (!stream) {
+        insertFile(fi, file_ID);
+        return true;
+    }
+    return stream->push(move(fi));
+}
 
+// compact directory - varint fields, UTF-8 names sharing prefix with previous name, compressed by codec
+static void putVarInt(vector<Byte>& buf, QWord i) {
+    Byte  bytes[VARINT_MAX_SIZE];
+    DWord size = writeVarInt(bytes, i);
+    buf.insert(buf.end(), bytes, bytes + size);
+}
+
+// signed difference to previous value, small in both directions
+static void putDelta(vector<Byte>& buf, QWord i, QWord previous) {
+    long long delta = (long long)(i - previous);
+    putVarInt(buf, ((QWord)delta << 1) ^ (QWord)(delta >> 63));
+}
+
+class CompactListReader {
+private:
+    Byte* pos;
+    Byte* end;
+public:
+    bool ok;
+    CompactListReader(Byte* buf, QWord size) : pos(buf), end(buf + size), ok(true) {}
+    QWord varInt() {
+        QWord i(0);
+        DWord size = ok ? readVarInt(pos, end, &i) : 0;
+        if (size == 0) ok = false;
+        pos += size;
+        return i;
+    }
+    QWord delta(QWord previous) {
+        QWord i = varInt();
+        return previous + (QWord)((i >> 1) ^ (QWord)(-(long long)(i & 1)));
+    }
+    Byte* bytes(QWord size) {
+        if (!ok || size > (QWord)(end - pos)) { ok = false; return nullptr; }
+        Byte* start = pos;
+        pos += size;
+        return start;
+    }
+};
+
+QWord FileList::writeFileList(ofstream &ofs, CodecInterface* codec) {
+    streampos beg = ofs.tellp();
+    vector<Byte> list;
+    putVarInt(list, number_of_files);
+    putVarInt(list, number_of_folders);
+    putVarInt(list, size_of_all_files);
+
+    FileHeader previous;
+    memset(&previous, 0, sizeof(FileHeader));
+    string previous_name;
     for (FileInfo& fi : file_list) {
-        ofs.write((char*)&fi.file_header, sizeof(FileHeader));
-        for (wchar_t wc : fi.relative_file_name)
-            ofs.write((char*)&wc, sizeof(wchar_t));
+        FileHeader& fh = fi.file_header;
+        putVarInt(list, fh.flags);
+
+        // name - length of prefix shared with previous name and rest of name
+        string name = toUTF8(fi.relative_file_name);
+        QWord  prefix = 0;
+        while (prefix < name.size() && prefix < previous_name.size() && name[prefix] == previous_name[prefix]) prefix++;
+        putVarInt(list, prefix);
+        putVarInt(list, name.size() - prefix);
+        list.insert(list.end(), name.begin() + prefix, name.end());
+        previous_name.swap(name);
+
+        putVarInt(list, fh.file_size);
+        putVarInt(list, fh.file_compressed_size);
+        putVarInt(list, fh.file_attributes);
+        putDelta (list, fh.file_creation_time,     previous.file_creation_time);
+        putDelta (list, fh.file_modification_time, previous.file_modification_time);
+        putDelta (list, fh.file_access_time,       previous.file_access_time);
+        putVarInt(list, fh.file_hash);
+        putDelta (list, fh.file_data_pos,          previous.file_data_pos);
+        if (fh.flags & F_SOLID) putVarInt(list, fh.file_solid_pos);
+        previous = fh;
+
+        // seek table, positions grow
+        if (fh.flags & F_SEEKTABLE) {
+            putVarInt(list, fi.seek_table.size());
+            BlockPosition last = { 0, 0 };
+            for (BlockPosition& block : fi.seek_table) {
+                putVarInt(list, block.in_pos  - last.in_pos);
+                putVarInt(list, block.out_pos - last.out_pos);
+                last = block;
+            }
+        }
+
+        // chunk list, chunks follow each other in file but can be stored anywhere in archive
+        if (fh.flags & F_CHUNKED) {
+            putVarInt(list, fi.chunk_list.size());
+            ChunkPosition last = { 0, 0, 0 };
+            for (ChunkPosition& chunk : fi.chunk_list) {
+                putVarInt(list, chunk.in_pos - last.in_pos);
+                putDelta (list, chunk.out_pos, last.out_pos);
+                putVarInt(list, chunk.compressed_size);
+                last = chunk;
+            }
+        }
+
+        // codec other than default
+        if (fh.flags & F_CODEC) {
+            putVarInt(list, fi.codec.id);
+            putVarInt(list, fi.codec.level);
+        }
     }
 
+    // sizes of list and compressed list, then compressed list
+    vector<Byte> compressed;
+    MemoryInputStream  input(list.data(), list.size());
+    BufferOutputStream output(&compressed);
+    codec->compressStream(&input, &output);
+
+    QWord list_size = list.size(), compressed_size = compressed.size();
+    ofs.write((char*)&list_size,       sizeof(QWord));
+    ofs.write((char*)&compressed_size, sizeof(QWord));
+    ofs.write((char*)compressed.data(), compressed.size());
+
     streampos end = ofs.tellp();
     return end - beg;
 }
 
-QWord FileList::readFileList(ifstream &ifs) {
-    streampos beg = ifs.tellg();
+// compact directory is read at once and parsed from memory
+bool FileList::readFileList(InputStreamInterface* input, CodecInterface* codec) {
     file_list.clear();
 
-    ifs.read((char*)&number_of_files,   sizeof(QWord));
-    ifs.read((char*)&number_of_folders, sizeof(QWord));
-    ifs.read((char*)&size_of_all_files, sizeof(QWord));
+    QWord list_size(0), compressed_size(0);
+    input->read((Byte*)&list_size, sizeof(QWord));
+    if (input->getReadSize() != sizeof(QWord)) return false;
+    input->read((Byte*)&compressed_size, sizeof(QWord));
+    if (input->getReadSize() != sizeof(QWord) || compressed_size > input->getSize() - input->getPos()) return false;
+
+    vector<Byte> compressed;
+    if (!appendStream(input, compressed, compressed_size)) return false;
+
+    // list grows with decoded data, damaged sizes can not cause huge allocation
+    vector<Byte> list;
+    MemoryInputStream  list_input(compressed.data(), compressed.size());
+    BufferOutputStream output(&list);
+    codec->decompressStream(&list_input, &output);
+    if (codec->isCorrupted() || list.size() != list_size) return false;
+
+    CompactListReader reader(list.data(), list.size());
+    number_of_files   = reader.varInt();
+    number_of_folders = reader.varInt();
+    size_of_all_files = reader.varInt();
+
+    FileHeader previous;
+    memset(&previous, 0, sizeof(FileHeader));
+    string name;
+    for (QWord i = 0; i < number_of_files + number_of_folders && reader.ok; i++) {
+        FileInfo fi;
+        FileHeader& fh = fi.file_header;
+        memset(&fh, 0, sizeof(FileHeader));
+        fh.flags = (Byte)reader.varInt();
+
+        QWord prefix = reader.varInt();
+        QWord suffix = reader.varInt();
+        Byte* suffix_bytes = reader.bytes(suffix);
+        if (!reader.ok || prefix > name.size()) return false;
+        name.resize(prefix);
+        name.append((char*)suffix_bytes, suffix);
+        fi.relative_file_name = fromUTF8((Byte*)name.data(), name.size());
+
+        fh.file_name_length       = (Word)fi.relative_file_name.length();
+        fh.file_ID                = i;
+        fh.file_size              = reader.varInt();
+        fh.file_compressed_size   = reader.varInt();
+        fh.file_attributes        = (DWord)reader.varInt();
+        fh.file_creation_time     = reader.delta(previous.file_creation_time);
+        fh.file_modification_time = reader.delta(previous.file_modification_time);
+        fh.file_access_time       = reader.delta(previous.file_access_time);
+        fh.file_hash              = (DWord)reader.varInt();
+        fh.file_data_pos          = reader.delta(previous.file_data_pos);
+        if (fh.flags & F_SOLID) fh.file_solid_pos = reader.varInt();
+        previous = fh;
+
+        // seek table
+        if (fh.flags & F_SEEKTABLE) {
+            QWord seek_table_size = reader.varInt();
+            if (seek_table_size > fh.file_compressed_size) return false;
+            BlockPosition last = { 0, 0 };
+            for (QWord n = 0; n < seek_table_size && reader.ok; n++) {
+                last.in_pos  += reader.varInt();
+                last.out_pos += reader.varInt();
+                fi.seek_table.push_back(last);
+            }
+        }
+
+        // chunk list
+        if (fh.flags & F_CHUNKED) {
+            QWord chunk_list_size = reader.varInt();
+            if (chunk_list_size > fh.file_size / CHUNK_MIN_SIZE + 1) return false;
+            ChunkPosition last = { 0, 0, 0 };
+            for (QWord n = 0; n < chunk_list_size && reader.ok; n++) {
+                last.in_pos         += reader.varInt();
+                last.out_pos         = reader.delta(last.out_pos);
+                last.compressed_size = reader.varInt();
+                fi.chunk_list.push_back(last);
+            }
+        }
+
+        // codec, unknown one is found when file is decoded
+        if (fh.flags & F_CODEC) {
+            QWord id    = reader.varInt();
+            QWord level = reader.varInt();
+            if (id > 0xFF || level > 0xFF) return false;
+            fi.codec.id    = (Byte)id;
+            fi.codec.level = (Byte)level;
+        }
+
+        file_list.push_back(fi);
+    }
+
+    buildIndex();
+    return reader.ok;
+}
+
+// plain directory has no checksum, names of damaged entries can not be converted to paths
+static bool isValidName(const wstring& name) {
+    for (wchar_t wc : name) {
+        DWord c = (DWord)wc;
+        if (c == 0 || c > 0x10FFFF || (sizeof(wchar_t) > 2 && c >= 0xD800 && c < 0xE000)) return false;
+    }
+    return !name.empty();
+}
+
+// file data positions are not stored, files follow each other from data_pos
+bool FileList::readFileList(InputStreamInterface* input, QWord data_pos) {
+    file_list.clear();
+
+    input->read((Byte*)&number_of_files,   sizeof(QWord));
+    input->read((Byte*)&number_of_folders, sizeof(QWord));
+    input->read((Byte*)&size_of_all_files, sizeof(QWord));
+
+    for (QWord i = 0; i < number_of_files + number_of_folders; i++) {
+        PlainFileHeader plain;
+        input->read((Byte*)&plain, sizeof(PlainFileHeader));
+        if (input->getReadSize() != sizeof(PlainFileHeader)) return false;
 
-    for (int i = 0; (i < number_of_files + number_of_folders) && !ifs.eof() ; i++) {
         FileInfo fi;
-        ifs.read((char*)&fi.file_header, sizeof(FileHeader));
-        fi.relative_file_name.clear();
-        for (int j = 0; j < fi.file_header.file_name_length; j++) {
-            wchar_t wc;
-            ifs.read((char*)&wc, sizeof(wchar_t));
-            fi.relative_file_name += wc;
-        }
-        
+        FileHeader& fh = fi.file_header;
+        memset(&fh, 0, sizeof(FileHeader));
+        fh.flags                  = plain.flags & F_ISDIR;
+        fh.file_name_length       = plain.file_name_length;
+        fh.file_size              = plain.file_size;
+        fh.file_compressed_size   = plain.file_compressed_size;
+        fh.file_attributes        = plain.file_attributes;
+        fh.file_creation_time     = plain.file_creation_time;
+        fh.file_modification_time = plain.file_modification_time;
+        fh.file_access_time       = plain.file_access_time;
+        fh.file_hash              = plain.file_hash;
+        fh.file_ID                = plain.file_ID;
+        if (!(fh.flags & F_ISDIR)) {
+            fh.file_data_pos = data_pos;
+            data_pos += fh.file_compressed_size;
+        }
+
+        fi.relative_file_name.resize(fh.file_name_length);
+        if (fh.file_name_length > 0)
+            input->read((Byte*)&fi.relative_file_name[0], fh.file_name_length * sizeof(wchar_t));
+        if (input->getReadSize() != fh.file_name_length * sizeof(wchar_t) || !isValidName(fi.relative_file_name)) return false;
+
         file_list.push_back(fi);
+    }
+
+    buildIndex();
+    return true;
+}
+
+// names are compared with '/' as separator, archives can come from other systems
+static wstring indexName(const wstring& name) {
+    wstring index_name = name;
+    for (wchar_t& wc : index_name) if (wc == L'\\') wc = L'/';
+    while (!index_name.empty() && index_name.back() == L'/') index_name.pop_back();
+    return index_name;
+}
+
+void FileList::buildIndex() {
+    file_index.clear();
+    file_index.reserve(file_list.size());
+    for (QWord i = 0; i < file_list.size(); i++)
+        file_index[indexName(file_list[i].relative_file_name)] = i;
+}
+
+FileInfo* FileList::findFile(wstring& relative_file_name) {
+    auto it = file_index.find(indexName(relative_file_name));
+    if (it == file_index.end()) return nullptr;
+    return &file_list[it->second];
+}
+
+// select files by exact names (directories with their content) or wildcard patterns
+void FileList::selectFiles(vector<wstring>& patterns, vector<FileInfo*>& selected) {
+    vector<Byte> is_selected(file_list.size(), false);
+
+    for (wstring& pattern : patterns) {
+        wstring index_pattern = indexName(pattern);
 
+        if (index_pattern.find_first_of(L"*?") != wstring::npos) {
+            // wildcards need full scan
+            for (QWord i = 0; i < file_list.size(); i++) {
+                if (matchPattern(index_pattern.c_str(), indexName(file_list[i].relative_file_name).c_str()))
+                    is_selected[i] = true;
+            }
+        } else {
+            // exact name is found by index
+            auto it = file_index.find(index_pattern);
+            if (it == file_index.end()) continue;
+            is_selected[it->second] = true;
+
+            // whole directory
+            if (file_list[it->second].file_header.flags & F_ISDIR) {
+                wstring prefix = index_pattern + L'/';
+                for (QWord i = 0; i < file_list.size(); i++) {
+                    if (indexName(file_list[i].relative_file_name).compare(0, prefix.length(), prefix) == 0)
+                        is_selected[i] = true;
+                }
+            }
+        }
     }
 
-    if (ifs.eof()) ifs.clear();
-    streampos end = ifs.tellg();
-    return end - beg;
+    // keep file list order
+    selected.clear();
+    for (QWord i = 0; i < file_list.size(); i++)
+        if (is_selected[i]) selected.push_back(&file_list[i]);
+}
+
+// order files so similar ones are next to each other: by extension, content fingerprint if asked, name stem
+void FileList::sortFiles(vector<QWord>& order, bool by_content, DWord threads) {
+    struct SortKey {
+        wstring extension;
+        wstring stem;
+        DWord   sketch[MIN_HASH_SIZE];
+    };
+    vector<SortKey> keys(file_list.size());
+    for (QWord i : order) {
+        path relative_file_name = toPath(file_list[i].relative_file_name);
+        keys[i].extension = fromPath(relative_file_name.extension());
+        keys[i].stem      = fromPath(relative_file_name.stem());
+        transform(keys[i].extension.begin(), keys[i].extension.end(), keys[i].extension.begin(), towlower);
+        transform(keys[i].stem.begin(),      keys[i].stem.end(),      keys[i].stem.begin(),      towlower);
+        memset(keys[i].sketch, 0, sizeof(keys[i].sketch));
+    }
+
+    // fingerprint of sampled start of every file
+    if (by_content) {
+        atomic<QWord> next(0);
+        vector<thread> workers;
+        for (DWord t = 0; t < threads; t++) {
+            workers.emplace_back([&]() {
+                vector<Byte> sample(SIMILARITY_SAMPLE_SIZE);
+                for (QWord n = next++; n < order.size(); n = next++) {
+                    QWord i = order[n];
+                    ifstream ifile(toPath(file_list[i].absolute_file_name), ios::binary);
+                    ifile.read((char*)sample.data(), sample.size());
+                    minHash(sample.data(), ifile.gcount(), keys[i].sketch);
+                }
+            });
+        }
+        for (thread& worker : workers) worker.join();
+    }
+
+    stable_sort(order.begin(), order.end(), [&](QWord a, QWord b) {
+        if (keys[a].extension != keys[b].extension) return keys[a].extension < keys[b].extension;
+        int sketch_order = memcmp(keys[a].sketch, keys[b].sketch, sizeof(keys[a].sketch));
+        if (sketch_order != 0) return sketch_order < 0;
+        return keys[a].stem < keys[b].stem;
+    });
+}
+
+// find identical files, only files sharing size with another file are compared by strong hash
+void FileList::findDuplicates(vector<QWord>& order, vector<QWord>& original, DWord threads) {
+    original.resize(file_list.size());
+    for (QWord i = 0; i < original.size(); i++) original[i] = i;
+
+    unordered_map<QWord, vector<QWord>> same_size;
+    for (QWord i : order) {
+        if (file_list[i].file_header.file_size > 0) same_size[file_list[i].file_header.file_size].push_back(i);
+    }
+    vector<QWord> candidates;
+    for (auto& files : same_size) {
+        if (files.second.size() > 1) candidates.insert(candidates.end(), files.second.begin(), files.second.end());
+    }
+    if (candidates.empty()) return;
+
+    // hash candidates on worker threads, unreadable files get no hash
+    vector<string> digests(file_list.size());
+    atomic<QWord> next(0);
+    vector<thread> workers;
+    for (DWord t = 0; t < threads; t++) {
+        workers.emplace_back([&]() {
+            StrongHashing strong_hashing;
+            vector<Byte>  buf(0x100000);
+            for (QWord n = next++; n < candidates.size(); n = next++) {
+                QWord i = candidates[n], read_size = 0;
+                ifstream ifile(toPath(file_list[i].absolute_file_name), ios::binary);
+                strong_hashing.init();
+                while (ifile.read((char*)buf.data(), buf.size()) || ifile.gcount() > 0) {
+                    strong_hashing.updateHash(buf.data(), ifile.gcount());
+                    read_size += ifile.gcount();
+                }
+                if (read_size != file_list[i].file_header.file_size) continue;
+
+                Byte digest[STRONG_HASH_SIZE];
+                strong_hashing.getHash(digest);
+                digests[i].assign((char*)digest, STRONG_HASH_SIZE);
+            }
+        });
+    }
+    for (thread& worker : workers) worker.join();
+
+    // first file in order is original of all identical files
+    unordered_map<string, QWord> first_file;
+    for (QWord i : order) {
+        if (digests[i].empty()) continue;
+        auto first = first_file.emplace(digests[i], i);
+        if (!first.second) original[i] = first.first->second;
+    }
 }
 
-void FileList::createFileList(vector<wstring>&file_names) {
-    this->file_names = file_names;
+void FileList::createFileList(vector<wstring>&file_names, DWord threads, QWord stream_size) {
+    // entries of previous scan are dropped, streamed entries are numbered from 0 again
+    if (thread_future.valid()) thread_future.wait();
+    file_list.clear();
+    file_index.clear();
+    number_of_files   = 0;
+    number_of_folders = 0;
+    size_of_all_files = 0;
+
+    this->file_names   = file_names;
+    this->scan_threads = threads;
+    this->scanned      = 0;
+    this->stream.reset(stream_size > 0 ? new WorkQueue<FileInfo>(stream_size) : nullptr);
     thread_future = async(std::launch::async, &FileList::createFileListThread, this);
 }
 
+// next entry in list order, false when all entries were passed or stream was closed
+bool FileList::nextFile(FileInfo& fi) {
+    return stream && stream->pop(fi);
+}
+
+// scan stops passing entries, reader gets only those already waiting
+void FileList::closeStream() {
+    if (stream) stream->close();
+}
+
+QWord FileList::getStreamSize() {
+    return stream ? stream->size() : 0;
+}
+
+QueueStats FileList::getStreamStats() {
+    return stream ? stream->getStats() : QueueStats{ 0, 0, 0 };
+}
+
+// entry taken from other file list, e.g. kept from archive being appended to
+void FileList::appendFile(FileInfo& fi) {
+    if (fi.file_header.flags & F_ISDIR) {
+        number_of_folders++;
+    } else {
+        size_of_all_files += fi.file_header.file_size;
+        number_of_files++;
+    }
+    file_list.push_back(fi);
+    file_list.back().file_header.file_ID = file_list.size() - 1;
+}
+
 vector<FileInfo>*FileList::getFileList() {
     return &this->file_list;
 }
@@ -133,25 +726,40 @@ QWord FileList::getSizeOfAllFiles() {
     return this->size_of_all_files;
 }
 
-bool FileList::isCompleted() {
-    return thread_future.wait_for(std::chrono::seconds(0)) == future_status::ready;
+bool FileList::isCompleted(DWord wait_ms) {
+    return thread_future.wait_for(std::chrono::milliseconds(wait_ms)) == future_status::ready;
 }
 
 void FileList::waitUntilCompleted() {
-    while (!isCompleted()) { }
+    thread_future.wait();
+}
+
+// files and folders found so far, list itself is complete when scan is completed
+QWord FileList::getScannedCount() {
+    return this->scanned;
 }
 
 void FileList::updateFiles(wstring& dir) {
-    for (FileInfo& fi : file_list) {
-        fi.absolute_file_name = wstring(path(dir) / path(fi.relative_file_name));
-        
-        setFileTime(fi.absolute_file_name.c_str(),
-            fi.file_header.file_creation_time,
-            fi.file_header.file_access_time,
-            fi.file_header.file_modification_time);
+    for (FileInfo& fi : file_list) updateFile(fi, dir);
+}
 
-        setFileAttributes(fi.absolute_file_name.c_str(), fi.file_header.file_attributes);
-    }
+void FileList::updateFile(FileInfo& fi, wstring& dir) {
+    fi.absolute_file_name = fromPath(toPath(dir) / toPath(fi.relative_file_name));
+
+    // times and attributes through one open handle
+    FileMetadata metadata;
+    getMetadata(fi, metadata);
+    FileHandle file;
+    if (file.open(fi.absolute_file_name.c_str(), true)) file.setMetadata(metadata);
+}
+
+// metadata to be restored by extracted file
+void FileList::getMetadata(FileInfo& fi, FileMetadata& metadata) {
+    metadata.size              = fi.file_header.file_size;
+    metadata.attributes        = fi.file_header.file_attributes;
+    metadata.creation_time     = fi.file_header.file_creation_time;
+    metadata.access_time       = fi.file_header.file_access_time;
+    metadata.modification_time = fi.file_header.file_modification_time;
 }
 
 }
@@ -14,10 +14,22 @@
 #include <filesystem>
 #include <locale>
 #include <future>
+#include <unordered_map>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <cwctype>
 
 // Archive
 #include "Types.h"
 #include "Utils.h"
+#include "Hashing.h"
+#include "WorkQueue.h"
+#include "Codecs.h"
 
 
 using namespace std;
@@ -25,7 +37,13 @@ using namespace std::filesystem;
 
 namespace SCL {
 
-enum FileFlags { F_ISDIR = 1 };
+enum FileFlags { F_ISDIR = 1, F_SEEKTABLE = 2, F_SOLID = 4, F_DUPLICATE = 8, F_CHUNKED = 16, F_CODEC = 32 };
+
+// bytes read from start of file for content fingerprint
+const QWord SIMILARITY_SAMPLE_SIZE = 0x1000;
+
+// time between progress callbacks while files are counted
+const DWord SCAN_PROGRESS_INTERVAL = 50;
 
 struct FileHeader {
     Byte  flags;
@@ -38,12 +56,38 @@ struct FileHeader {
     QWord file_access_time;
     DWord file_hash;
     QWord file_ID;
+    QWord file_data_pos;
+    QWord file_solid_pos;      // position in decompressed solid group if F_SOLID is set
+};
+
+// file header of archives without AF_COMPACT_LIST, file data stored one after another in list order
+struct PlainFileHeader {
+    Byte  flags;
+    Word  file_name_length;
+    QWord file_size;
+    QWord file_compressed_size;
+    DWord file_attributes;
+    QWord file_creation_time;
+    QWord file_modification_time;
+    QWord file_access_time;
+    DWord file_hash;
+    QWord file_ID;
+};
+
+// chunk of file data, compressed alone and stored once per archive
+struct ChunkPosition {
+    QWord in_pos;
+    QWord out_pos;          // position in archive
+    QWord compressed_size;
 };
 
 struct FileInfo {
     FileHeader file_header;
     wstring    absolute_file_name;
     wstring    relative_file_name;
+    vector<BlockPosition> seek_table;   // codec blocks, stored after file name if F_SEEKTABLE is set
+    vector<ChunkPosition> chunk_list;   // chunks of file, stored after seek table if F_CHUNKED is set
+    CodecChoice           codec;        // codec of file data, stored after chunk list if F_CODEC is set
 };
 
 class FileList {
@@ -52,25 +96,44 @@ protected:
     future<void> thread_future;
     vector<FileInfo> file_list;
     vector<wstring>  file_names;
+    unordered_map<wstring, QWord> file_index;   // relative file name -> position in file list
     QWord number_of_files;
     QWord number_of_folders;
     QWord size_of_all_files;
+    DWord scan_threads;
+    atomic<QWord> scanned;
+    unique_ptr<WorkQueue<FileInfo>> stream;    // entries passed in list order instead of filling list
     void createFileListThread();
-    void insertFile(wstring& absolute_file_name, wstring& relative_file_name, QWord& file_ID);
+    void insertFile(FileInfo& fi, QWord& file_ID);
+    bool addEntry(FileInfo& fi, QWord& file_ID);
 
 public:
     FileList();
     ~FileList();
-    void createFileList(vector<wstring>& file_names);
-    QWord writeFileList(ofstream& ofs);
-    QWord readFileList(ifstream& ifs);
+    void createFileList(vector<wstring>& file_names, DWord threads = 1, QWord stream_size = 0);  // directories are listed by threads
+    bool  nextFile(FileInfo& fi);   // entries of streamed list, reader puts them to list by appendFile
+    void  closeStream();
+    QWord getStreamSize();          // entries waiting for reader
+    QueueStats getStreamStats();
+    void appendFile(FileInfo& fi);
+    QWord writeFileList(ofstream& ofs, CodecInterface* codec);
+    bool  readFileList(InputStreamInterface* input, CodecInterface* codec);
+    bool  readFileList(InputStreamInterface* input, QWord data_pos);    // directory of archives without AF_COMPACT_LIST
     vector<FileInfo>* getFileList();
-    bool  isCompleted();
+    void  buildIndex();
+    FileInfo* findFile(wstring& relative_file_name);
+    void  selectFiles(vector<wstring>& patterns, vector<FileInfo*>& selected);
+    void  sortFiles(vector<QWord>& order, bool by_content, DWord threads);
+    void  findDuplicates(vector<QWord>& order, vector<QWord>& original, DWord threads);
+    bool  isCompleted(DWord wait_ms = 0);
+    QWord getScannedCount();
     void  waitUntilCompleted();
     QWord getNumberOfFiles();
     QWord getNumberOfFolders();
     QWord getSizeOfAllFiles();
     void  updateFiles(wstring &dir);
+    void  updateFile(FileInfo& fi, wstring &dir);
+    static void getMetadata(FileInfo& fi, FileMetadata& metadata);
     void lockList();
     void unlockList();
 };
@@ -47,6 +47,147 @@ DWord Hashing::getHash() {
     return this->hash;
 }
 
+DWord SCL::blockHash(Byte* in, QWord size) {
+    DWord hash = 0x811C9DC5;
+    for (QWord i = 0; i < size; i++) {
+        hash ^= in[i];
+        hash *= 0x1000193;
+    }
+    return hash;
+}
+
+// random value for every byte, same on every run
+struct GearTable {
+    QWord values[256];
+    GearTable() {
+        QWord seed = 0x9E3779B97F4A7C15;
+        for (int i = 0; i < 256; i++) {
+            QWord z = (seed += 0x9E3779B97F4A7C15);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+            values[i] = z ^ (z >> 31);
+        }
+    }
+};
+static const GearTable gear_table;
+
+QWord SCL::findChunkEnd(Byte* in, QWord size) {
+    if (size <= CHUNK_MIN_SIZE) return size;
+    if (size > CHUNK_MAX_SIZE) size = CHUNK_MAX_SIZE;
+
+    // harder cut condition below average size, easier above it - chunk sizes stay close to average
+    const QWord mask_small = 0xFFFF800000000000;
+    const QWord mask_large = 0xFFF8000000000000;
+    QWord hash   = 0;
+    QWord i      = CHUNK_MIN_SIZE;
+    QWord normal = min(size, CHUNK_AVG_SIZE);
+    for (; i < normal; i++) {
+        hash = (hash << 1) + gear_table.values[in[i]];
+        if (!(hash & mask_small)) return i + 1;
+    }
+    for (; i < size; i++) {
+        hash = (hash << 1) + gear_table.values[in[i]];
+        if (!(hash & mask_large)) return i + 1;
+    }
+    return size;
+}
+
+void SCL::minHash(Byte* in, QWord size, DWord* sketch) {
+    for (DWord k = 0; k < MIN_HASH_SIZE; k++) sketch[k] = 0xFFFFFFFF;
+    for (QWord i = 0; i + 8 <= size; i++) {
+        DWord shingle = blockHash(in + i, 8);
+        // one cheap permutation of shingle hash per sketch value
+        for (DWord k = 0; k < MIN_HASH_SIZE; k++) {
+            DWord h = (shingle ^ (0x9E3779B9 * (k + 1))) * 0x85EBCA6B;
+            h ^= h >> 13;
+            if (h < sketch[k]) sketch[k] = h;
+        }
+    }
+}
+
+// SHA-256
+static const DWord SHA256_K[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+static inline DWord rotr(DWord x, DWord n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+StrongHashing::StrongHashing() {
+    init();
+}
+
+void StrongHashing::init() {
+    static const DWord initial_state[8] = {
+        0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+    };
+    memcpy(state, initial_state, sizeof(state));
+    block_size = 0;
+    total_size = 0;
+}
+
+void StrongHashing::transform(Byte* data) {
+    DWord w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (DWord(data[i * 4]) << 24) | (DWord(data[i * 4 + 1]) << 16) | (DWord(data[i * 4 + 2]) << 8) | DWord(data[i * 4 + 3]);
+    }
+    for (int i = 16; i < 64; i++) {
+        DWord s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        DWord s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19)  ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    DWord a = state[0], b = state[1], c = state[2], d = state[3];
+    DWord e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        DWord t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+        DWord t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void StrongHashing::updateHash(Byte* in, QWord size) {
+    total_size += size;
+    while (size > 0) {
+        QWord part = min<QWord>(size, 64 - block_size);
+        memcpy(block + block_size, in, part);
+        block_size += part;
+        in         += part;
+        size       -= part;
+        if (block_size == 64) {
+            transform(block);
+            block_size = 0;
+        }
+    }
+}
+
+void StrongHashing::getHash(Byte* digest) {
+    // padding and message length in bits
+    QWord bit_size = total_size * 8;
+    Byte  padding[72] = { 0x80 };
+    QWord padding_size = (block_size < 56 ? 56 : 120) - block_size;
+    for (int i = 0; i < 8; i++) padding[padding_size + i] = Byte(bit_size >> (56 - i * 8));
+    updateHash(padding, padding_size + 8);
+
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4]     = Byte(state[i] >> 24);
+        digest[i * 4 + 1] = Byte(state[i] >> 16);
+        digest[i * 4 + 2] = Byte(state[i] >> 8);
+        digest[i * 4 + 3] = Byte(state[i]);
+    }
+}
+
 HashingOutputStream::HashingOutputStream(HashingInterface* hashing, OutputStreamInterface *output_stream) {
     this->hashing       = hashing;
     this->output_stream = output_stream;
@@ -58,3 +199,22 @@ bool HashingOutputStream::write(Byte* buf, QWord size) {
     return true;
 }
 
+HashingInputStream::HashingInputStream(HashingInterface* hashing, InputStreamInterface *input_stream) {
+    this->hashing      = hashing;
+    this->input_stream = input_stream;
+}
+
+bool HashingInputStream::read(Byte* buf, QWord size) {
+    bool ret = input_stream->read(buf, size);
+    this->read_size = input_stream->getReadSize();
+    hashing->updateHash(buf, this->read_size);
+    return ret;
+}
+
+QWord HashingInputStream::getPos() {
+    return input_stream->getPos();
+}
+
+QWord HashingInputStream::getSize() {
+    return input_stream->getSize();
+}
@@ -39,6 +39,36 @@ public:
     DWord getHash();
 };
 
+// FNV hash of memory block (used as codec block checksum)
+DWord blockHash(Byte* in, QWord size);
+
+// SHA-256, strong content hash for finding identical files
+const DWord STRONG_HASH_SIZE = 32;
+
+class StrongHashing {
+private:
+    DWord state[8];
+    Byte  block[64];
+    QWord block_size;
+    QWord total_size;
+    void  transform(Byte* data);
+public:
+    StrongHashing();
+    void init();
+    void updateHash(Byte* in, QWord size);
+    void getHash(Byte* digest);
+};
+
+// content-defined chunking (FastCDC, gear rolling hash), chunk always fits one codec block
+const QWord CHUNK_MIN_SIZE = 0x2000;
+const QWord CHUNK_AVG_SIZE = 0x8000;
+const QWord CHUNK_MAX_SIZE = 0xFFFF;
+QWord findChunkEnd(Byte* in, QWord size);
+
+// MinHash sketch of 8 byte shingles, similar data shares sketch values
+const DWord MIN_HASH_SIZE = 4;
+void minHash(Byte* in, QWord size, DWord* sketch);
+
 class HashingOutputStream : public OutputStreamInterface {
 private:
     HashingInterface* hashing;
@@ -48,6 +78,18 @@ public:
     bool write(Byte* buf, QWord size);
 };
 
+// hashes data while it is read, so file is read only once during compression
+class HashingInputStream : public InputStreamInterface {
+private:
+    HashingInterface* hashing;
+    InputStreamInterface *input_stream;
+public:
+    HashingInputStream(HashingInterface *hashing, InputStreamInterface* input_stream);
+    bool read(Byte* buf, QWord size);
+    QWord getPos();
+    QWord getSize();
+};
+
 
 }
 
@@ -102,6 +102,7 @@ void Huffman::writeTree(HuffmanTree *node) {
 
 // reading tree from stream
 HuffmanTree *Huffman::readTree(HuffmanTree *node) {
+	if (node == nullptr || node >= nodes + nodes_array_size) return nullptr;
 	int bit = bit_stream->readBit();
 	if (bit == 1) {
 		node->symbol = bit_stream->readBits(8);
@@ -109,8 +110,10 @@ HuffmanTree *Huffman::readTree(HuffmanTree *node) {
 		node->freq   = 0;
 		return node;
 	} else if (bit == 0) {
+		HuffmanTree *right_last = readTree(node + 1);
+		if (right_last == nullptr) return nullptr;
 		node->right = node + 1;
-		node->left  = readTree(node->right) + 1;
+		node->left  = right_last + 1;
 		return readTree(node->left);
 	}
 	return nullptr;
@@ -144,57 +147,136 @@ Huffman::~Huffman() {
     if (bit_stream)        delete bit_stream;
 }
 
+// largest block header, compact one
+static const DWord HUFFMAN_HEADER_MAX_SIZE = BLOCK_HEADER_MAX_SIZE + VARINT_MAX_SIZE;
+
+// block header - fixed one is [uncompressed size][encoded size][checksum], compact one has
+// encoded size behind checksum, stored block has none
+static DWord putHeader(Byte* buf, BlockFormat format, bool stored, QWord in_size, QWord out_size, DWord* checksum) {
+    if (format == BF_COMPACT) {
+        DWord header_size = putBlockHeader(buf, format, stored ? BLOCK_STORED : 0, in_size, checksum);
+        return stored ? header_size : header_size + writeVarInt(buf + header_size, out_size);
+    }
+    QWord block_size = stored ? in_size | STORED_BLOCK : in_size;
+    memcpy(buf, &block_size, sizeof(QWord));
+    memcpy(buf + sizeof(QWord), &out_size, sizeof(QWord));
+    if (checksum) memcpy(buf + sizeof(QWord) * 2, checksum, sizeof(DWord));
+    return sizeof(QWord) * 2 + (checksum ? sizeof(DWord) : 0);
+}
+
+static bool readHeader(InputStreamInterface* input, BlockFormat format, bool* stored, QWord* out_size, QWord* in_size,
+    DWord* checksum, vector<Byte>* block = nullptr) {
+    Byte flags(0);
+    if (format == BF_COMPACT) {
+        if (!readBlockHeader(input, format, &flags, out_size, checksum, block) || (flags & ~BLOCK_STORED)) return false;
+        *stored = flags == BLOCK_STORED;
+        if (*stored) *in_size = *out_size;
+        return *stored || readBlockSize(input, format, in_size, block);
+    }
+    if (!readBlockHeader(input, format, &flags, out_size, nullptr, block) || !readBlockSize(input, format, in_size, block)) return false;
+    *stored = flags == BLOCK_STORED;
+    return !checksum || readStream(input, (Byte*)checksum, sizeof(DWord), block);
+}
+
 QWord Huffman::compressStream(InputStreamInterface* input, OutputStreamInterface* output) {
-    QWord in_size = 0, out_size = 0;
+    QWord in_size = 0, out_size = 0, total_in_size = 0;
 
     clock_t clock_begin = clock();
     CodecCallbackInfo callback_info = { 0, 0, 0, 0, 0, 0 };
 
     while (input->getPos() < input->getSize()) {
 
-        // read data
-        input->read(uncompressed_bytes, 0xFFFF);
-        in_size = input->getReadSize();
+        // read data, borrowed from input memory when possible
+        Byte* in_bytes = input->peek(0xFFFF, &in_size);
+        if (in_bytes) {
+            input->consume(in_size);
+        } else {
+            input->read(uncompressed_bytes, 0xFFFF);
+            in_size  = input->getReadSize();
+            in_bytes = uncompressed_bytes;
+        }
 
         reset();
 
-        // write input size to stream
-        bit_stream->assignBuffer(compressed_bytes);
-
-        // build and write tree
-        countFrequencies(uncompressed_bytes, in_size);
-        buildTree();
-        makeCodes(root, 0, 0);
-        writeTree(root);
-
-        // for each byte write assigned code to output
-        for (QWord i = 0; i < in_size; i++) {
-            HuffmanCode* currentCode = codes + uncompressed_bytes[i];
-            bit_stream->writeBits(currentCode->code, currentCode->bit_count);
+        // histogram is kept for size of encoded block
+        countFrequencies(in_bytes, in_size);
+        QWord freq[256], symbols(0);
+        for (int s = 0; s < alphabet_size; s++) {
+            freq[s] = nodes[s].freq;
+            if (freq[s] > 0) symbols++;
         }
 
-        // close last byte with 0 bits
-        while (bit_stream->getBitPos() > 0) bit_stream->writeBit(0);
-
-        // update info
-        out_size   = bit_stream->getBytePos();
+        // codes are never shorter than entropy, tree is not built when block can not get smaller
+        bool stored = entropyBits(freq, in_size) + symbols * 10 >= in_size * 8 + 1;
+        if (!stored) {
+            buildTree();
+            makeCodes(root, 0, 0);
+
+            // tree takes 9 bits per leaf and 1 bit per inner node
+            QWord bit_count = 0;
+            for (int s = 0; s < alphabet_size; s++) {
+                if (freq[s] > 0) bit_count += 10 + freq[s] * codes[s].bit_count;
+            }
+            out_size = (bit_count - 1 + 7) / 8;
+            stored   = out_size >= in_size;
+        }
 
-        // write data
-        output->write((Byte*)&in_size,  sizeof(QWord));
-        output->write((Byte*)&out_size, sizeof(QWord));
-        output->write(compressed_bytes, out_size);
+        // stored block keeps its data as it is, both sizes are equal
+        Byte  header[HUFFMAN_HEADER_MAX_SIZE];
+        DWord checksum = block_checksum ? blockHash(in_bytes, in_size) : 0;
+        if (stored) {
+            if (block_index) block_index->push_back({ total_in_size, output->getPos() });
+            total_in_size += in_size;
+
+            DWord header_size = putHeader(header, block_format, true, in_size, in_size, block_checksum ? &checksum : nullptr);
+            output->write(header, header_size);
+            output->write(in_bytes, in_size);
+            out_size = in_size;
+            callback_info.out_size += header_size;
+        } else {
+
+            // codes go straight to output memory when it can be lent
+            DWord header_size = putHeader(header, block_format, false, in_size, out_size, block_checksum ? &checksum : nullptr);
+            Byte* out_bytes   = output->reserve(header_size + out_size);
+            bit_stream->assignBuffer(out_bytes ? out_bytes + header_size : compressed_bytes);
+
+            // write tree
+            writeTree(root);
+
+            // for each byte write assigned code to output
+            for (QWord i = 0; i < in_size; i++) {
+                HuffmanCode* currentCode = codes + in_bytes[i];
+                bit_stream->writeBits(currentCode->code, currentCode->bit_count);
+            }
+
+            // close last byte with 0 bits
+            while (bit_stream->getBitPos() > 0) bit_stream->writeBit(0);
+
+            // block start for seek table
+            if (block_index) block_index->push_back({ total_in_size, output->getPos() });
+            total_in_size += in_size;
+
+            // write data
+            if (out_bytes) {
+                memcpy(out_bytes, header, header_size);
+                output->commit(header_size + out_size);
+            } else {
+                output->write(header, header_size);
+                output->write(compressed_bytes, out_size);
+            }
+            callback_info.out_size += header_size;
+        }
 
         // callback
         callback_info.in_pos    = input->getPos() == -1 ? input->getSize() : input->getPos();
         callback_info.in_size   = input->getSize();
-        callback_info.out_size += out_size + (sizeof(QWord) * 2);
+        callback_info.out_size += out_size;
         callback_info.progress  = COUNTPRECENT(callback_info.in_pos, callback_info.in_size);
         callback_info.ratio     = COUNTPRECENT(callback_info.out_size, callback_info.in_pos);
         callback_info.clock     = COUNTTIME(clock_begin);
 
         if (this->callback) {
-            memcpy_s(&this->callback->info, sizeof(CodecCallbackInfo),
-                &callback_info, sizeof(CodecCallbackInfo));
+            memcpy(&this->callback->info, &callback_info, sizeof(CodecCallbackInfo));
             if (!this->callback->callback((input->getPos() < input->getSize()) ? CLT_PROGRESS : CLT_STREAM_FINISH))
                 break;
         }
@@ -210,26 +292,60 @@ QWord Huffman::decompressStream(InputStreamInterface* input, OutputStreamInterfa
 
     clock_t clock_begin = clock();
     CodecCallbackInfo callback_info = { 0, 0, 0, 0, 0, 0 };
+    corrupted = false;
 
     while (input->getPos() < input->getSize()) {
+        DWord checksum(0);
+        bool  stored(false);
+
+        // broken block header
+        if (!readHeader(input, block_format, &stored, &out_size, &in_size, block_checksum ? &checksum : nullptr) ||
+            out_size > 0xFFFF || in_size > (0xFFFF << 1) || (stored && in_size != out_size)) {
+            corrupted = true;
+            break;
+        }
 
-        input->read((Byte*)&out_size, sizeof(QWord));
-        input->read((Byte*)&in_size,  sizeof(QWord));
-        input->read(compressed_bytes, in_size);
+        // encoded data borrowed from input memory when possible
+        Byte* in_bytes = borrowStream(input, compressed_bytes, in_size);
+        if (in_bytes == nullptr) {
+            corrupted = true;
+            break;
+        }
 
-        in_size = input->getReadSize();
+        // stored block is checked and passed on as it is
+        if (stored) {
+            if (block_checksum && blockHash(in_bytes, out_size) != checksum) {
+                corrupted = true;
+                break;
+            }
+            output->write(in_bytes, out_size);
+        } else {
+            reset();
+
+            // read tree, reading is limited to the block - borrowed memory can end right behind it
+            bit_stream->assignBuffer(in_bytes, int(in_size));
+            if (out_size > 0 && (readTree(nodes) == nullptr || bit_stream->isOverrun())) {
+                corrupted = true;
+                break;
+            }
 
-        reset();
+            // symbols are decoded straight into output memory when it can be lent
+            Byte* out_bytes = output->reserve(out_size);
+            Byte* decoded   = out_bytes ? out_bytes : uncompressed_bytes;
 
-        // read decompressed size and tree
-        bit_stream->assignBuffer(compressed_bytes);
-        readTree(nodes);
+            // decode each symbol
+            for (QWord o = 0; o < out_size && !bit_stream->isOverrun(); o++) decoded[o] = Byte(decodeSymbol(nodes));
 
-        // decode each symbol
-        for (int o = 0; o < out_size; o++)
-            uncompressed_bytes[o] = Byte(decodeSymbol(nodes));
+            // verify block before it reaches output
+            if (bit_stream->isOverrun() || (block_checksum && blockHash(decoded, out_size) != checksum)) {
+                if (out_bytes) output->commit(0);
+                corrupted = true;
+                break;
+            }
 
-        output->write(uncompressed_bytes, out_size);
+            if (out_bytes) output->commit(out_size);
+            else           output->write(uncompressed_bytes, out_size);
+        }
 
         callback_info.in_pos    = input->getPos() == -1 ? input->getSize() : input->getPos();
         callback_info.in_size   = in_size + (sizeof(QWord) * 2);
@@ -239,8 +355,7 @@ QWord Huffman::decompressStream(InputStreamInterface* input, OutputStreamInterfa
         callback_info.clock     = COUNTTIME(clock_begin);
 
         if (this->callback) {
-            memcpy_s(&this->callback->info, sizeof(CodecCallbackInfo),
-                &callback_info, sizeof(CodecCallbackInfo));
+            memcpy(&this->callback->info, &callback_info, sizeof(CodecCallbackInfo));
             if (!this->callback->callback((input->getPos() < input->getSize()) ? CLT_PROGRESS : CLT_STREAM_FINISH))
                 break;
         }
@@ -248,3 +363,18 @@ QWord Huffman::decompressStream(InputStreamInterface* input, OutputStreamInterfa
 
     return callback_info.out_size;
 }
+
+// copy one encoded block without decoding it
+bool Huffman::readBlock(InputStreamInterface* input, vector<Byte>& block) {
+    QWord out_size(0), size(0);
+    DWord checksum(0);
+    bool  stored(false);
+    block.clear();
+
+    // block header
+    if (!readHeader(input, block_format, &stored, &out_size, &size, block_checksum ? &checksum : nullptr, &block))
+        return false;
+
+    // encoded data
+    return size <= (0xFFFF << 1) && appendStream(input, block, size);
+}
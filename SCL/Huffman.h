@@ -13,6 +13,7 @@
 #include "Utils.h"
 #include "BitStream.h"
 #include "Streams.h"
+#include "Hashing.h"
 
 namespace SCL {
 
@@ -63,6 +64,7 @@ public:
 	~Huffman();
     QWord compressStream(InputStreamInterface* rs, OutputStreamInterface* ws);
     QWord decompressStream(InputStreamInterface* rs, OutputStreamInterface* ws);
+    bool  readBlock(InputStreamInterface* input, vector<Byte>& block);
 };
 
 } // namespace
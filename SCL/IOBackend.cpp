@@ -0,0 +1,304 @@
+////////////////////////////////////////////
+// Small Compression Library              //
+// author: Mariusz Ziach                  //
+// www   : http://ziach.pl/               //
+// date  : 2020                           //
+////////////////////////////////////////////
+
+// C++
+#include <filesystem>
+
+// Archive
+#include "IOBackend.h"
+
+#if defined(__linux__) && defined(SCL_IO_URING)
+// Linux
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace SCL {
+
+IOBackendInterface::~IOBackendInterface() {}
+
+// whole file through file streams, used for single requests and by thread pool
+static void readFile(FileRequest& request) {
+    ifstream ifile(toPath(request.file_name), ios::binary);
+    request.done = 0;
+    request.ok   = ifile.is_open();
+    if (!request.ok || request.size == 0) return;
+    ifile.read((char*)request.data, request.size);
+    request.done = (QWord)ifile.gcount();
+    request.ok   = !ifile.bad();
+}
+
+static void writeFile(FileRequest& request) {
+    FileHandle ofile;
+    request.ok = ofile.create(request.file_name.c_str()) && ofile.write(request.data, request.size);
+    if (request.ok && request.metadata) ofile.setMetadata(*request.metadata);
+    request.done = request.ok ? request.size : 0;
+}
+
+// thread pool backend
+ThreadIOBackend::ThreadIOBackend(DWord thread_count) : tasks(thread_count) {
+    this->thread_count = thread_count > 0 ? thread_count : 1;
+    this->pending      = 0;
+}
+
+ThreadIOBackend::~ThreadIOBackend() {
+    tasks.close();
+    for (thread& t : threads) t.join();
+}
+
+void ThreadIOBackend::work() {
+    IOTask task;
+    while (tasks.pop(task)) {
+        if (task.write) writeFile(*task.request);
+        else            readFile(*task.request);
+
+        lock_guard<mutex> lock(done_mutex);
+        if (--pending == 0) batch_done.notify_all();
+    }
+}
+
+// single file is done by caller, threads are started with first batch worth sharing
+void ThreadIOBackend::run(vector<FileRequest>& batch, bool write) {
+    if (batch.size() == 1) {
+        if (write) writeFile(batch[0]);
+        else       readFile(batch[0]);
+        return;
+    }
+    if (batch.empty()) return;
+    while (threads.size() < thread_count) threads.emplace_back(&ThreadIOBackend::work, this);
+
+    {
+        lock_guard<mutex> lock(done_mutex);
+        pending = batch.size();
+    }
+    for (FileRequest& request : batch) tasks.push({ &request, write });
+
+    unique_lock<mutex> lock(done_mutex);
+    batch_done.wait(lock, [this] { return pending == 0; });
+}
+
+void ThreadIOBackend::read(vector<FileRequest>& batch) {
+    run(batch, false);
+}
+
+void ThreadIOBackend::write(vector<FileRequest>& batch) {
+    run(batch, true);
+}
+
+#if defined(__linux__) && defined(SCL_IO_URING)
+// io_uring backend, rings are used through system calls and shared memory directly
+static int uringSetup(DWord entries, io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uringEnter(int ring, DWord submit, DWord wait) {
+    return (int)syscall(__NR_io_uring_enter, ring, submit, wait, IORING_ENTER_GETEVENTS, nullptr, 0);
+}
+
+UringIOBackend::UringIOBackend() {
+    ring     = -1;
+    entries  = 0;
+    sq_ring  = cq_ring = sqe_ring = MAP_FAILED;
+    sq_ring_size = cq_ring_size = sqe_ring_size = 0;
+}
+
+UringIOBackend::~UringIOBackend() {
+    if (sqe_ring != MAP_FAILED) munmap(sqe_ring, sqe_ring_size);
+    if (cq_ring  != MAP_FAILED) munmap(cq_ring,  cq_ring_size);
+    if (sq_ring  != MAP_FAILED) munmap(sq_ring,  sq_ring_size);
+    if (ring >= 0) ::close(ring);
+}
+
+bool UringIOBackend::open(DWord queue_depth) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring = uringSetup(queue_depth > 0 ? queue_depth : 1, &params);
+    if (ring < 0) return false;
+
+    // opening, reading, writing and closing through ring came with kernel 5.6, as did this feature
+    if (!(params.features & IORING_FEAT_RW_CUR_POS)) return false;
+
+    entries       = params.sq_entries;
+    sq_ring_size  = params.sq_off.array + params.sq_entries * sizeof(DWord);
+    cq_ring_size  = params.cq_off.cqes  + params.cq_entries * sizeof(io_uring_cqe);
+    sqe_ring_size = params.sq_entries * sizeof(io_uring_sqe);
+    sq_ring  = mmap(nullptr, sq_ring_size,  PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+    cq_ring  = mmap(nullptr, cq_ring_size,  PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+    sqe_ring = mmap(nullptr, sqe_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+    if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqe_ring == MAP_FAILED) return false;
+
+    Byte* sq = (Byte*)sq_ring;
+    Byte* cq = (Byte*)cq_ring;
+    sq_head  = (DWord*)(sq + params.sq_off.head);
+    sq_tail  = (DWord*)(sq + params.sq_off.tail);
+    sq_mask  = (DWord*)(sq + params.sq_off.ring_mask);
+    sq_array = (DWord*)(sq + params.sq_off.array);
+    cq_head  = (DWord*)(cq + params.cq_off.head);
+    cq_tail  = (DWord*)(cq + params.cq_off.tail);
+    cq_mask  = (DWord*)(cq + params.cq_off.ring_mask);
+    cqes     = (io_uring_cqe*)(cq + params.cq_off.cqes);
+    sqes     = (io_uring_sqe*)sqe_ring;
+    return true;
+}
+
+// submit at most entries operations and wait for all of them, results in order of operations
+bool UringIOBackend::submit(vector<io_uring_sqe>& ops, vector<int>& results) {
+    DWord count = (DWord)ops.size();
+    DWord tail  = *sq_tail;
+    for (DWord i = 0; i < count; i++) {
+        DWord index = (tail + i) & *sq_mask;
+        sqes[index] = ops[i];
+        sqes[index].user_data = i;
+        sq_array[index] = index;
+    }
+    __atomic_store_n(sq_tail, tail + count, __ATOMIC_RELEASE);
+
+    results.assign(count, -ECANCELED);
+    DWord submitted = 0, completed = 0;
+    while (completed < count) {
+        int ret = uringEnter(ring, count - submitted, count - completed);
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        submitted += ret;
+
+        DWord head = *cq_head;
+        DWord end  = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != end; head++) {
+            io_uring_cqe& cqe = cqes[head & *cq_mask];
+            if (cqe.user_data < count) results[cqe.user_data] = cqe.res;
+            completed++;
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+// whole batch is opened, transferred and closed in three rounds of submissions, short transfers add rounds
+void UringIOBackend::run(vector<FileRequest>& batch, bool write) {
+    for (QWord first = 0; first < batch.size(); first += entries) {
+        QWord count = min((QWord)entries, batch.size() - first);
+        vector<string>       names(count);
+        vector<int>          files(count, -1), results;
+        vector<bool>         ended(count, false);
+        vector<io_uring_sqe> ops(count);
+
+        for (QWord i = 0; i < count; i++) {
+            FileRequest& request = batch[first + i];
+            names[i] = toPath(request.file_name).native();
+            request.done = 0;
+            request.ok   = false;
+            memset(&ops[i], 0, sizeof(io_uring_sqe));
+            ops[i].opcode     = IORING_OP_OPENAT;
+            ops[i].fd         = AT_FDCWD;
+            ops[i].addr       = (QWord)names[i].c_str();
+            ops[i].len        = 0666;
+            ops[i].open_flags = write ? O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC : O_RDONLY | O_CLOEXEC;
+        }
+
+        // ring failed, batch is done by file streams
+        if (!submit(ops, results)) {
+            for (QWord i = 0; i < count; i++) {
+                if (write) writeFile(batch[first + i]);
+                else       readFile(batch[first + i]);
+            }
+            continue;
+        }
+        for (QWord i = 0; i < count; i++) {
+            files[i] = results[i];
+            batch[first + i].ok = files[i] >= 0;
+        }
+
+        // transfer until every file is complete, failed or ended
+        while (true) {
+            vector<QWord> owners;
+            ops.clear();
+            for (QWord i = 0; i < count; i++) {
+                FileRequest& request = batch[first + i];
+                if (!request.ok || ended[i] || request.done >= request.size) continue;
+                io_uring_sqe op;
+                memset(&op, 0, sizeof(io_uring_sqe));
+                op.opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+                op.fd     = files[i];
+                op.addr   = (QWord)(request.data + request.done);
+                op.len    = (DWord)min(request.size - request.done, (QWord)0x40000000);
+                op.off    = request.done;
+                ops.push_back(op);
+                owners.push_back(i);
+            }
+            if (ops.empty()) break;
+
+            bool submitted = submit(ops, results);
+            for (QWord k = 0; k < owners.size(); k++) {
+                FileRequest& request = batch[first + owners[k]];
+                if (!submitted || results[k] < 0) request.ok = false;
+                else if (results[k] == 0)         ended[owners[k]] = true;
+                else                              request.done += results[k];
+            }
+        }
+
+        // metadata is set before file is closed
+        if (write) {
+            for (QWord i = 0; i < count; i++) {
+                FileRequest& request = batch[first + i];
+                if (request.ok && request.metadata && request.done == request.size) setFileMetadata(files[i], *request.metadata);
+            }
+        }
+
+        // close opened files
+        vector<QWord> owners;
+        ops.clear();
+        for (QWord i = 0; i < count; i++) {
+            if (files[i] < 0) continue;
+            io_uring_sqe op;
+            memset(&op, 0, sizeof(io_uring_sqe));
+            op.opcode = IORING_OP_CLOSE;
+            op.fd     = files[i];
+            ops.push_back(op);
+            owners.push_back(i);
+        }
+        bool closed = ops.empty() || submit(ops, results);
+        for (QWord k = 0; k < owners.size(); k++) {
+            FileRequest& request = batch[first + owners[k]];
+            if (!closed) ::close(files[owners[k]]);
+            if (!closed || results[k] < 0) request.ok = false;
+        }
+
+        // written file is complete only with all its data, read file can be shorter than expected
+        if (write) {
+            for (QWord i = 0; i < count; i++) {
+                FileRequest& request = batch[first + i];
+                request.ok = request.ok && request.done == request.size;
+            }
+        }
+    }
+}
+
+void UringIOBackend::read(vector<FileRequest>& batch) {
+    run(batch, false);
+}
+
+void UringIOBackend::write(vector<FileRequest>& batch) {
+    run(batch, true);
+}
+#endif
+
+IOBackendInterface* createIOBackend(DWord queue_depth) {
+#if defined(__linux__) && defined(SCL_IO_URING)
+    UringIOBackend* uring = new UringIOBackend;
+    if (uring->open(queue_depth)) return uring;
+    delete uring;
+#endif
+    return new ThreadIOBackend(queue_depth);
+}
+
+} // namespace
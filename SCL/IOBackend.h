@@ -0,0 +1,101 @@
+////////////////////////////////////////////
+// Small Compression Library              //
+// author: Mariusz Ziach                  //
+// www   : http://ziach.pl/               //
+// date  : 2020                           //
+////////////////////////////////////////////
+
+#ifndef SCL_IOBACKEND_H
+#define SCL_IOBACKEND_H
+
+// C++
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Archive
+#include "Types.h"
+#include "Utils.h"
+#include "WorkQueue.h"
+
+#if defined(__linux__) && defined(SCL_IO_URING)
+// Linux
+#include <linux/io_uring.h>
+#endif
+
+namespace SCL {
+
+// larger files are read and written by workers themselves
+const QWord IO_BATCH_MAX_SIZE = 0x40000;
+
+// whole file read into data or written from it
+struct FileRequest {
+    wstring       file_name;
+    Byte*         data;
+    QWord         size;
+    QWord         done;     // bytes read or written, file can be shorter than expected
+    bool          ok;
+    FileMetadata* metadata; // set on written file before it is closed, if given
+};
+
+// batched file I/O, one instance is used by one thread at a time
+class IOBackendInterface {
+public:
+    virtual ~IOBackendInterface() = 0;
+    virtual void read(vector<FileRequest>& batch) = 0;
+    virtual void write(vector<FileRequest>& batch) = 0;
+};
+
+// pool of threads, each opens, reads or writes and closes its own files
+class ThreadIOBackend : public IOBackendInterface {
+private:
+    struct IOTask {
+        FileRequest* request;
+        bool         write;
+    };
+    DWord              thread_count;
+    vector<thread>     threads;
+    WorkQueue<IOTask>  tasks;
+    mutex              done_mutex;
+    condition_variable batch_done;
+    QWord              pending;
+    void run(vector<FileRequest>& batch, bool write);
+    void work();
+public:
+    ThreadIOBackend(DWord thread_count);
+    ~ThreadIOBackend();
+    void read(vector<FileRequest>& batch);
+    void write(vector<FileRequest>& batch);
+};
+
+#if defined(__linux__) && defined(SCL_IO_URING)
+// io_uring - opens, reads or writes and closes of whole batch go through one submission each
+class UringIOBackend : public IOBackendInterface {
+private:
+    int    ring;
+    DWord  entries;
+    void*  sq_ring;
+    void*  cq_ring;
+    void*  sqe_ring;
+    size_t sq_ring_size, cq_ring_size, sqe_ring_size;
+    DWord *sq_head, *sq_tail, *sq_mask, *sq_array;
+    DWord *cq_head, *cq_tail, *cq_mask;
+    io_uring_sqe* sqes;
+    io_uring_cqe* cqes;
+    void run(vector<FileRequest>& batch, bool write);
+    bool submit(vector<io_uring_sqe>& ops, vector<int>& results);
+public:
+    UringIOBackend();
+    ~UringIOBackend();
+    bool open(DWord queue_depth);
+    void read(vector<FileRequest>& batch);
+    void write(vector<FileRequest>& batch);
+};
+#endif
+
+// io_uring if built with it and kernel supports it, thread pool otherwise
+IOBackendInterface* createIOBackend(DWord queue_depth);
+
+} // namespace
+
+#endif // SCL_IOBACKEND_H
@@ -5,6 +5,9 @@
 // date  : 2020                           //
 ////////////////////////////////////////////
 
+// C++
+#include <algorithm>
+
 // LHZX
 #include "LZ.h"
 #include "Utils.h"
@@ -181,18 +184,24 @@ LZMatch *LZMatchFinder::find(QWord pos) {
     return best_match;
 }
 
-// lz algorith main class
+// lz algorith main class, levels differ only in match search - decoder is the same for all of them
 LZ::LZ(LZCompressionLevel comp_level) {
     switch (comp_level) {
     case LCL_FASTEST:
+        cdc_sttgs.Set(16, 2, 8, 16, 0);
+        break;
     case LCL_FAST:
-    case LCL_NORMAL:
+        cdc_sttgs.Set(16, 2, 8, 16, 2);
+        break;
     case LCL_BEST:
+        cdc_sttgs.Set(16, 2, 8, 16, 6);
+        break;
+    case LCL_NORMAL:
     default:
         cdc_sttgs.Set(16, 2, 8, 16, 4);
-        cdc_sttgs.byte_lkp_hsh = 5;
         break;
     }
+    cdc_sttgs.byte_lkp_hsh = 5;
     lz_mf = new LZMatchFinder(&cdc_sttgs);
     lz_buf = new LZDictionaryBuffer(cdc_sttgs.byte_mtch_pos);
     uncompressed_bytes = new Byte[0xFFFF << 1];
@@ -215,96 +224,185 @@ LZCodecSettings* LZ::getSettings() {
     return &this->cdc_sttgs;
 }
 
-QWord LZ::compressStream(InputStreamInterface* input, OutputStreamInterface* output) {
-    clock_t clock_begin = clock();
-    CodecCallbackInfo callback_info = {0, 0, 0, 0, 0, 0};
+// sampled probe of block - bytes spread over whole alphabet and no repeated content,
+// match search would only cost time there
+static bool isIncompressible(Byte* in, QWord size) {
+    if (size < LZ_PROBE_MIN_SIZE) return false;
+
+    // order-0 entropy of every 4th byte
+    QWord histogram[256] = { 0 }, count(0);
+    for (QWord i = 0; i < size; i += 4, count++) histogram[in[i]]++;
+    if (entropyBits(histogram, count) < LZ_PROBE_ENTROPY * count) return false;
+
+    // 8 bytes at content-defined anchors - repeated data meets the same anchors in every copy
+    vector<QWord> anchors;
+    for (QWord i = 0; i + sizeof(QWord) <= size; i++) {
+        if (((read32From8Buf(in + i) * 2654435761u) >> 26) != 0) continue;
+        QWord value(0);
+        memcpy(&value, in + i, sizeof(QWord));
+        anchors.push_back(value);
+    }
+    sort(anchors.begin(), anchors.end());
+    QWord repeats(0);
+    for (QWord i = 1; i < anchors.size(); i++) {
+        if (anchors[i] == anchors[i - 1]) repeats++;
+    }
+    return repeats * LZ_PROBE_REPEATS <= anchors.size();
+}
 
-    while (input->getPos() < input->getSize()) {
+// match search over one block, stream sizes in o
+void LZ::encodeBlock(Byte* in_bytes, QWord in_size, QWord* o) {
+    QWord i = 0;
+    for (int j = 0; j < LZ_NUMBER_OF_STREAMS; j++) o[j] = 0;
 
-        QWord o[LZ_NUMBER_OF_STREAMS], i = 0;
-        // 0 -> instructions; 1 -> pos; 2 -> len; 3 ->literal;
-        for (int i = 0; i < LZ_NUMBER_OF_STREAMS; i++)
-            o[i] = 0;
+    lz_mf->clear();
+    lz_buf->clear();
 
-        // input stream after compression will be empty
-        input->read(uncompressed_bytes, 0xFFFF);
-        QWord in_size = input->getReadSize();
+    // assign mem to match finder
+    lz_mf->assignBuffer(in_bytes, in_size, lz_buf);
 
-        lz_mf->clear();
-        lz_buf->clear();
+    match_empty.clear();
+    lz_match = &match_empty;
 
-        // assign mem to match finder, write input size int 1 stream
-        lz_mf->assignBuffer(uncompressed_bytes, in_size, lz_buf);
-        
-        match_empty.clear();
-        lz_match = &match_empty;
+    while (i < in_size) {
 
-        while (i < in_size) {
+        // search for best match
+        if (i + int(cdc_sttgs.byte_lkp_hsh) >= in_size) {
+            lz_match->len = 0;
+        } else {
+            lz_match = lz_mf->find(i);
+        }
 
-            // search for best match
-            if (i + int(cdc_sttgs.byte_lkp_hsh) >= in_size) {
-                lz_match->len = 0;
-            } else {
-                lz_match = lz_mf->find(i);
+        if ((lz_match->len > LZ_MIN_MATCH) &&
+            QWord(lz_match->len + lz_match->pos) < in_size) {
+
+            // write match to stream
+            lz_match->pos = lz_buf->convPos(true, lz_match->pos);
+
+            if (lz_match->pos < 256) {
+                compressed_bytes[LZ_INSTRUCTION][o[LZ_INSTRUCTION]++] = (Byte)(LZ_WRITEMATCH8);
+                compressed_bytes[LZ_MATCH_LEN]  [o[LZ_MATCH_LEN]  ++] = (Byte)(lz_match->len);
+                compressed_bytes[LZ_MATCH_POS]  [o[LZ_MATCH_POS]  ++] = (Byte)(lz_match->pos);
+            }  else {
+                compressed_bytes[LZ_INSTRUCTION][o[LZ_INSTRUCTION]++] = (Byte)(LZ_WRITEMATCH16);
+                compressed_bytes[LZ_MATCH_LEN]  [o[LZ_MATCH_LEN]  ++] = (Byte)(lz_match->len);
+                o[LZ_MATCH_POS] += write16To8Buf(compressed_bytes[LZ_MATCH_POS] + o[LZ_MATCH_POS], Word(lz_match->pos));
             }
 
-            if ((lz_match->len > LZ_MIN_MATCH) &&
-                QWord(lz_match->len + lz_match->pos) < in_size) {
+            // add skipped bytes into dictionary
+            while (lz_match->len--) {
+                lz_mf->insert(i);
+                lz_buf->putByte(in_bytes[i++]);
+            }
+        } else {
+            if (in_bytes[i] != LZ_WRITEMATCH8 &&
+                in_bytes[i] != LZ_WRITEMATCH16 &&
+                in_bytes[i] != LZ_WRITECHAR) {
+                compressed_bytes[LZ_INSTRUCTION][o[LZ_INSTRUCTION]++] = in_bytes[i];
+            } else {
 
-                // write match to stream
-                lz_match->pos = lz_buf->convPos(true, lz_match->pos);
+                // if previous instruction was 'write byte' then we will just increment length of bytes to write
+                if (o[LZ_INSTRUCTION] > 0 &&
+                    compressed_bytes[LZ_INSTRUCTION][o[LZ_INSTRUCTION] - 1] == (LZ_WRITECHAR) &&
+                    compressed_bytes[LZ_MATCH_LEN][o[LZ_MATCH_LEN] - 1] < 255) {
 
-                if (lz_match->pos < 256) {
-                    compressed_bytes[LZ_INSTRUCTION][o[LZ_INSTRUCTION]++] = (Byte)(LZ_WRITEMATCH8);
-                    compressed_bytes[LZ_MATCH_LEN]  [o[LZ_MATCH_LEN]  ++] = (Byte)(lz_match->len);
-                    compressed_bytes[LZ_MATCH_POS]  [o[LZ_MATCH_POS]  ++] = (Byte)(lz_match->pos);
-                }  else {
-                    compressed_bytes[LZ_INSTRUCTION][o[LZ_INSTRUCTION]++] = (Byte)(LZ_WRITEMATCH16);
-                    compressed_bytes[LZ_MATCH_LEN]  [o[LZ_MATCH_LEN]  ++] = (Byte)(lz_match->len);
-                    o[LZ_MATCH_POS] += write16To8Buf(compressed_bytes[LZ_MATCH_POS] + o[LZ_MATCH_POS], Word(lz_match->pos));
-                }
+                    // increment number of bytes to write
+                    compressed_bytes[LZ_MATCH_LEN]  [o[LZ_MATCH_LEN]   - 1]++; 
+                } else {
+
+                    // 'write byte' instruction
+                    compressed_bytes[LZ_INSTRUCTION][o[LZ_INSTRUCTION]++] = (Byte)(LZ_WRITECHAR);
 
-                // add skipped bytes into dictionary
-                while (lz_match->len--) {
-                    lz_mf->insert(i);
-                    lz_buf->putByte(uncompressed_bytes[i++]);
+                    // write one byte
+                    compressed_bytes[LZ_MATCH_LEN]  [o[LZ_MATCH_LEN]  ++] = 1;
                 }
-            } else {
-                if (uncompressed_bytes[i] != LZ_WRITEMATCH8 &&
-                    uncompressed_bytes[i] != LZ_WRITEMATCH16 &&
-                    uncompressed_bytes[i] != LZ_WRITECHAR) {
-                    compressed_bytes[LZ_INSTRUCTION][o[LZ_INSTRUCTION]++] = uncompressed_bytes[i];
-                } else {
+                compressed_bytes[LZ_CHAR][o[LZ_CHAR]++] = (Byte)(in_bytes[i]);
+            }
 
-                    // if previous instruction was 'write byte' then we will just increment length of bytes to write
-                    if (compressed_bytes[LZ_INSTRUCTION][o[LZ_INSTRUCTION] - 1] == (LZ_WRITECHAR) &&
-                        compressed_bytes[LZ_MATCH_LEN][o[LZ_MATCH_LEN] - 1] < 255) {
+            // add byte into dictionary
+            lz_mf->insert(i);
+            lz_buf->putByte(in_bytes[i++]);
+        }
+    }
+}
 
-                        // increment number of bytes to write
-                        compressed_bytes[LZ_MATCH_LEN]  [o[LZ_MATCH_LEN]   - 1]++; 
-                    } else {
+QWord LZ::compressStream(InputStreamInterface* input, OutputStreamInterface* output) {
+    clock_t clock_begin = clock();
+    CodecCallbackInfo callback_info = {0, 0, 0, 0, 0, 0};
+    QWord total_in_size = 0;
 
-                        // 'write byte' instruction
-                        compressed_bytes[LZ_INSTRUCTION][o[LZ_INSTRUCTION]++] = (Byte)(LZ_WRITECHAR);
+    while (input->getPos() < input->getSize()) {
 
-                        // write one byte
-                        compressed_bytes[LZ_MATCH_LEN]  [o[LZ_MATCH_LEN]  ++] = 1;
-                    }
-                    compressed_bytes[LZ_CHAR][o[LZ_CHAR]++] = (Byte)(uncompressed_bytes[i]);
-                }
+        // 0 -> instructions; 1 -> pos; 2 -> len; 3 ->literal;
+        QWord o[LZ_NUMBER_OF_STREAMS] = { 0, 0, 0, 0 };
+
+        // input stream after compression will be empty, block is borrowed from input memory when possible
+        QWord in_size(0);
+        Byte* in_bytes = input->peek(0xFFFF, &in_size);
+        if (in_bytes) {
+            input->consume(in_size);
+        } else {
+            input->read(uncompressed_bytes, 0xFFFF);
+            in_size  = input->getReadSize();
+            in_bytes = uncompressed_bytes;
+        }
 
-                // add byte into dictionary
-                lz_mf->insert(i);
-                lz_buf->putByte(uncompressed_bytes[i++]);
-            }
+        // block is stored as it is when it does not get smaller
+        bool stored = isIncompressible(in_bytes, in_size);
+        if (!stored) {
+            encodeBlock(in_bytes, in_size, o);
+            QWord encoded_size = sizeof(QWord) * LZ_NUMBER_OF_STREAMS;
+            for (int j = 0; j < LZ_NUMBER_OF_STREAMS; j++) encoded_size += o[j];
+            stored = encoded_size >= in_size;
         }
 
-        output->write((Byte*)&in_size, sizeof(QWord));
-        for (int j = 0; j < LZ_NUMBER_OF_STREAMS; j++) {
-            output->write((Byte*)&o[j], sizeof(QWord));
-            output->write(compressed_bytes[j], o[j]);
+        // block start for seek table
+        if (block_index) block_index->push_back({ total_in_size, output->getPos() });
+        total_in_size += in_size;
+
+        DWord checksum = block_checksum ? blockHash(in_bytes, in_size) : 0;
+        if (block_format == BF_COMPACT) {
+            // header with sizes of streams is one write, empty streams are only flagged
+            Byte header[LZ_HEADER_MAX_SIZE];
+            Byte flags = stored ? BLOCK_STORED : 0;
+            for (int j = 0; j < LZ_NUMBER_OF_STREAMS && !stored; j++) {
+                if (o[j] == 0) flags |= BLOCK_EMPTY_STREAM << j;
+            }
+            DWord header_size = putBlockHeader(header, block_format, flags, in_size, block_checksum ? &checksum : nullptr);
+            for (int j = 0; j < LZ_NUMBER_OF_STREAMS && !stored; j++) {
+                if (o[j] > 0) header_size += writeVarInt(header + header_size, o[j]);
+            }
+            output->write(header, header_size);
+            callback_info.out_size += header_size;
 
-            callback_info.out_size += o[j] + sizeof(QWord) + sizeof(QWord) * LZ_NUMBER_OF_STREAMS;
+            if (stored) {
+                output->write(in_bytes, in_size);
+                callback_info.out_size += in_size;
+            } else {
+                for (int j = 0; j < LZ_NUMBER_OF_STREAMS; j++) {
+                    if (o[j] > 0) output->write(compressed_bytes[j], o[j]);
+                    callback_info.out_size += o[j];
+                }
+            }
+        } else {
+            // one write per field, LZHuffman reads each of them as separate record
+            QWord block_size = stored ? in_size | STORED_BLOCK : in_size;
+            output->write((Byte*)&block_size, sizeof(QWord));
+            if (block_checksum) {
+                output->write((Byte*)&checksum, sizeof(DWord));
+                callback_info.out_size += sizeof(DWord);
+            }
+            if (stored) {
+                output->write(in_bytes, in_size);
+                callback_info.out_size += in_size + sizeof(QWord);
+            } else {
+                for (int j = 0; j < LZ_NUMBER_OF_STREAMS; j++) {
+                    output->write((Byte*)&o[j], sizeof(QWord));
+                    output->write(compressed_bytes[j], o[j]);
+
+                    callback_info.out_size += o[j] + sizeof(QWord) + sizeof(QWord) * LZ_NUMBER_OF_STREAMS;
+                }
+            }
         }
 
         // callback
@@ -315,8 +413,7 @@ QWord LZ::compressStream(InputStreamInterface* input, OutputStreamInterface* out
         callback_info.clock     = COUNTTIME(clock_begin);
 
         if (this->callback) {
-            memcpy_s(&this->callback->info, sizeof(CodecCallbackInfo),
-                &callback_info, sizeof(CodecCallbackInfo));
+            memcpy(&this->callback->info, &callback_info, sizeof(CodecCallbackInfo));
             if (!this->callback->callback((input->getPos() < input->getSize()) ? CLT_PROGRESS : CLT_STREAM_FINISH))
                 break;
         }
@@ -325,83 +422,176 @@ QWord LZ::compressStream(InputStreamInterface* input, OutputStreamInterface* out
     return callback_info.out_size;
 }
 
-QWord LZ::decompressStream(InputStreamInterface* input, OutputStreamInterface* output) {
-    clock_t clock_begin = clock();
-    CodecCallbackInfo callback_info = { 0, 0, 0, 0, 0, 0 };
-
-    while (input->getPos() < input->getSize()) {
+// decode streams of one block, number of decoded bytes returned, corrupted set on broken streams
+QWord LZ::decodeBlock(Byte** streams, QWord* in_size, Byte* decoded, QWord out_size) {
+    QWord i[LZ_NUMBER_OF_STREAMS] = { 0, 0, 0, 0 };
+    lz_buf->clear();
+
+    // every stream read is checked, borrowed memory can end right behind the stream
+    QWord o = 0;
+    while (o < out_size && !corrupted) {
+        if (i[LZ_INSTRUCTION] >= in_size[LZ_INSTRUCTION]) { corrupted = true; break; }
+        Byte c = streams[LZ_INSTRUCTION][i[LZ_INSTRUCTION]++];
+
+        // what to do?
+        if (c == LZ_WRITEMATCH8 || c == LZ_WRITEMATCH16) {
+            QWord pos(0), len(0);
+            QWord pos_bytes = c == LZ_WRITEMATCH16 ? sizeof(Word) : 1;
+            if (i[LZ_MATCH_POS] + pos_bytes > in_size[LZ_MATCH_POS] ||
+                i[LZ_MATCH_LEN] >= in_size[LZ_MATCH_LEN]) { corrupted = true; break; }
+
+            // read match
+            if (c == LZ_WRITEMATCH16) {
+                pos = read16From8Buf(streams[LZ_MATCH_POS] + i[LZ_MATCH_POS]);
+                i[LZ_MATCH_POS] += sizeof(Word);
+            }
+            else if (c == LZ_WRITEMATCH8) {
+                pos = streams[LZ_MATCH_POS][i[LZ_MATCH_POS]++];
+            }
 
-        QWord i[LZ_NUMBER_OF_STREAMS] = { 0,0,0,0 }, out_size(0), in_size[LZ_NUMBER_OF_STREAMS] = { 0, 0, 0, 0 }, total_in_size(0);
+            pos = lz_buf->convPos(false, pos);
+            len = streams[LZ_MATCH_LEN][i[LZ_MATCH_LEN]++];
+            if (o + len > out_size) { corrupted = true; break; }
 
-        lz_buf->clear();
-        input->read((Byte*)&out_size, sizeof(QWord));
+            // copy match
+            for (DWord j = 0; j < len; j++) {
+                Byte b = lz_buf->getByte(pos + j);
+                decoded[o++] = b;
+            }
 
-        for (int j = 0; j < LZ_NUMBER_OF_STREAMS; j++) {
-            input->read((Byte*)&in_size[j], sizeof(QWord));
-            input->read(compressed_bytes[j], in_size[j]);
-            i[j] = 0;
-            total_in_size += in_size[j];
+            // insert processed bytes into dictionary
+            for (DWord j = 0; j < len; j++)  lz_buf->putByte(decoded[(o-len)+j]);
+
+        } else if (c == LZ_WRITECHAR) {
+            // read uncompressed bytes
+            if (i[LZ_MATCH_LEN] >= in_size[LZ_MATCH_LEN]) { corrupted = true; break; }
+            QWord len = streams[LZ_MATCH_LEN][i[LZ_MATCH_LEN]++];
+            if (o + len > out_size || i[LZ_CHAR] + len > in_size[LZ_CHAR]) { corrupted = true; break; }
+            for (QWord j = 0; j < len; j++) {
+                lz_buf->putByte(streams[LZ_CHAR][i[LZ_CHAR]]);
+                decoded[o++] = streams[LZ_CHAR][i[LZ_CHAR]++];
+            }
+        }
+        else {
+            lz_buf->putByte(c);
+            decoded[o++] = c;
         }
+    }
+    return o;
+}
 
-        QWord o = 0;
-        while (o < out_size) {
-            Byte c = compressed_bytes[LZ_INSTRUCTION][i[LZ_INSTRUCTION]++];
+QWord LZ::decompressStream(InputStreamInterface* input, OutputStreamInterface* output) {
+    clock_t clock_begin = clock();
+    CodecCallbackInfo callback_info = { 0, 0, 0, 0, 0, 0 };
+    corrupted = false;
 
-            // what to do?
-            if (c == LZ_WRITEMATCH8 || c == LZ_WRITEMATCH16) {
-                QWord pos(0), len(0);
+    while (input->getPos() < input->getSize()) {
 
-                // read match
-                if (c == LZ_WRITEMATCH16) {
-                    pos = read16From8Buf(compressed_bytes[LZ_MATCH_POS] + i[LZ_MATCH_POS]);
-                    i[LZ_MATCH_POS] += sizeof(Word);
-                }
-                else if (c == LZ_WRITEMATCH8) {
-                    pos = compressed_bytes[LZ_MATCH_POS][i[LZ_MATCH_POS]++];
-                }
+        QWord out_size(0), in_size[LZ_NUMBER_OF_STREAMS] = { 0, 0, 0, 0 }, total_in_size(0);
+        DWord checksum(0);
+        Byte  flags(0);
 
-                pos = lz_buf->convPos(false, pos);
-                len = compressed_bytes[LZ_MATCH_LEN][i[LZ_MATCH_LEN]++];
-                
-                // copy match
-                for (DWord j = 0; j < len; j++) {
-                    Byte b = lz_buf->getByte(pos + j);
-                    uncompressed_bytes[o++] = b;
-                }
+        // broken block header or unknown flags
+        if (!readBlockHeader(input, block_format, &flags, &out_size, block_checksum ? &checksum : nullptr) ||
+            flags >= (BLOCK_EMPTY_STREAM << LZ_NUMBER_OF_STREAMS) || ((flags & BLOCK_STORED) && flags != BLOCK_STORED)) {
+            corrupted = true;
+            break;
+        }
+        bool stored = (flags & BLOCK_STORED) != 0;
+
+        // stored block is borrowed from input memory when possible, streams otherwise
+        Byte* streams[LZ_NUMBER_OF_STREAMS];
+        Byte* stored_bytes = nullptr;
+        if (stored) {
+            if (out_size <= 0xFFFF) stored_bytes = borrowStream(input, uncompressed_bytes, out_size);
+            if (stored_bytes == nullptr) corrupted = true;
+            total_in_size = out_size;
+        } else {
+            // compact header holds sizes of streams which are not empty, fixed block has size before every stream
+            for (int j = 0; j < LZ_NUMBER_OF_STREAMS && block_format == BF_COMPACT; j++) {
+                if (flags & (BLOCK_EMPTY_STREAM << j)) continue;
+                if (!readBlockSize(input, block_format, &in_size[j]) || in_size[j] == 0) { corrupted = true; break; }
+            }
+            for (int j = 0; j < LZ_NUMBER_OF_STREAMS && !corrupted; j++) {
+                if (block_format == BF_FIXED) input->read((Byte*)&in_size[j], sizeof(QWord));
+                if (in_size[j] > (0xFFFF << 1)) { corrupted = true; break; }
+                if (block_format == BF_COMPACT && in_size[j] == 0) streams[j] = compressed_bytes[j];
+                else streams[j] = borrowStream(input, compressed_bytes[j], in_size[j]);
+                if (streams[j] == nullptr) { corrupted = true; break; }
+                total_in_size += in_size[j];
+            }
+        }
 
-                // insert processed bytes into dictionary
-                for (DWord j = 0; j < len; j++)  lz_buf->putByte(uncompressed_bytes[(o-len)+j]);
+        // broken block header
+        if (corrupted || out_size > 0xFFFF) {
+            corrupted = true;
+            break;
+        }
 
-            } else if (c == LZ_WRITECHAR) {
-                // read uncompressed_bytes bytes
-                int len = compressed_bytes[LZ_MATCH_LEN][i[LZ_MATCH_LEN]++];
-                for (int j = 0; j < len; j++) {
-                    lz_buf->putByte(compressed_bytes[LZ_CHAR][i[LZ_CHAR]]);
-                    uncompressed_bytes[o++] = compressed_bytes[LZ_CHAR][i[LZ_CHAR]++];
-                }
+        // stored block is checked and passed on as it is
+        if (stored) {
+            if (block_checksum && blockHash(stored_bytes, out_size) != checksum) {
+                corrupted = true;
+                break;
             }
-            else {
-                lz_buf->putByte(c);
-                uncompressed_bytes[o++] = c;
+            output->write(stored_bytes, out_size);
+        } else {
+
+            // block is decoded straight into output memory when it can be lent
+            Byte* out_bytes = output->reserve(out_size);
+            Byte* decoded   = out_bytes ? out_bytes : uncompressed_bytes;
+            QWord o         = decodeBlock(streams, in_size, decoded, out_size);
+
+            // verify block before it reaches output
+            if (corrupted || o != out_size || (block_checksum && blockHash(decoded, o) != checksum)) {
+                if (out_bytes) output->commit(0);
+                corrupted = true;
+                break;
             }
-        }
 
-        output->write(uncompressed_bytes, o);
+            if (out_bytes) output->commit(o);
+            else           output->write(uncompressed_bytes, o);
+        }
 
         // callback
         callback_info.in_pos   = input->getPos() == -1 ? input->getSize() : input->getPos();
         callback_info.in_size  = total_in_size + sizeof(QWord) + sizeof(QWord) * LZ_NUMBER_OF_STREAMS;
-        callback_info.out_size += o;
+        callback_info.out_size += out_size;
         callback_info.progress = COUNTPRECENT(callback_info.in_pos, callback_info.in_size);
         callback_info.ratio    = COUNTPRECENT(callback_info.out_size, callback_info.in_pos);
         callback_info.clock    = COUNTTIME(clock_begin);
 
         if (this->callback) {
-            memcpy_s(&this->callback->info, sizeof(CodecCallbackInfo),
-                &callback_info, sizeof(CodecCallbackInfo));
+            memcpy(&this->callback->info, &callback_info, sizeof(CodecCallbackInfo));
             if (!this->callback->callback((input->getPos() < input->getSize()) ? CLT_PROGRESS : CLT_STREAM_FINISH))
                 break;
         }
     }
     return callback_info.out_size;
 }
+
+// copy one encoded block without decoding it
+bool LZ::readBlock(InputStreamInterface* input, vector<Byte>& block) {
+    QWord size(0), sizes[LZ_NUMBER_OF_STREAMS] = { 0, 0, 0, 0 };
+    DWord checksum(0);
+    Byte  flags(0);
+    block.clear();
+
+    // block header
+    if (!readBlockHeader(input, block_format, &flags, &size, block_checksum ? &checksum : nullptr, &block)) return false;
+
+    // stored data
+    if (flags & BLOCK_STORED) return flags == BLOCK_STORED && size <= 0xFFFF && appendStream(input, block, size);
+
+    // streams, compact block has their sizes in header
+    if (flags >= (BLOCK_EMPTY_STREAM << LZ_NUMBER_OF_STREAMS)) return false;
+    for (int j = 0; j < LZ_NUMBER_OF_STREAMS; j++) {
+        if (block_format == BF_COMPACT && !(flags & (BLOCK_EMPTY_STREAM << j)) &&
+            !readBlockSize(input, block_format, &sizes[j], &block)) return false;
+    }
+    for (int j = 0; j < LZ_NUMBER_OF_STREAMS; j++) {
+        if (block_format == BF_FIXED && !readBlockSize(input, block_format, &sizes[j], &block)) return false;
+        if (sizes[j] > (0xFFFF << 1) || !appendStream(input, block, sizes[j])) return false;
+    }
+    return true;
+}
@@ -13,6 +13,7 @@
 #include "Utils.h"
 #include "BitStream.h"
 #include "Streams.h"
+#include "Hashing.h"
 
 // number of LZ streams
 #define LZ_NUMBER_OF_STREAMS 4
@@ -31,6 +32,14 @@
 // others
 #define LZ_MIN_MATCH    4   // minimum match len
 
+// compact block header with varint sizes of all streams
+#define LZ_HEADER_MAX_SIZE (BLOCK_HEADER_MAX_SIZE + VARINT_MAX_SIZE * LZ_NUMBER_OF_STREAMS)
+
+// incompressible block probe
+#define LZ_PROBE_MIN_SIZE 0x1000    // smaller blocks are always searched
+#define LZ_PROBE_ENTROPY  7.92      // minimum bits per sampled byte
+#define LZ_PROBE_REPEATS  32        // at most one in this many anchors repeated
+
 namespace SCL {
 
 // compression level
@@ -123,12 +132,15 @@ private:
     LZMatch            *lz_match;
     LZMatchFinder      *lz_mf;
     LZDictionaryBuffer *lz_buf;
+    void  encodeBlock(Byte* in_bytes, QWord in_size, QWord* o);
+    QWord decodeBlock(Byte** streams, QWord* in_size, Byte* decoded, QWord out_size);
 public:
     LZ(LZCompressionLevel comp_level = LCL_NORMAL);
     ~LZ();
     LZCodecSettings* getSettings();
     QWord compressStream  (InputStreamInterface* input, OutputStreamInterface* output);
     QWord decompressStream(InputStreamInterface* input, OutputStreamInterface* output);
+    bool  readBlock(InputStreamInterface* input, vector<Byte>& block);
 };
 
 } // namespace
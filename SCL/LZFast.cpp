@@ -0,0 +1,280 @@
+////////////////////////////////////////////
+// Small Compression Library              //
+// author: Mariusz Ziach                  //
+// www   : http://ziach.pl/               //
+// date  : 2020                           //
+////////////////////////////////////////////
+
+#include "LZFast.h"
+
+using namespace SCL;
+
+LZFast::LZFast() {
+    uncompressed_bytes = new Byte[0xFFFF];
+    compressed_bytes   = new Byte[0xFFFF << 1];
+    lookup             = new Word[1 << LZF_HASH_BITS];
+}
+
+LZFast::~LZFast() {
+    if (uncompressed_bytes) delete[] uncompressed_bytes;
+    if (compressed_bytes)   delete[] compressed_bytes;
+    if (lookup)             delete[] lookup;
+}
+
+static DWord hashValue(Byte* in) {
+    return (read32From8Buf(in) * 2654435761u) >> (32 - LZF_HASH_BITS);
+}
+
+// length above nibble goes to varint
+static Byte* writeLength(Byte* out, QWord length) {
+    if (length >= LZF_NIBBLE_MAX) out += writeVarInt(out, length - LZF_NIBBLE_MAX);
+    return out;
+}
+
+static Byte* writeSequence(Byte* out, Byte* literals, QWord literal_length, QWord offset, QWord match_length) {
+    QWord match_code = match_length > 0 ? match_length - LZF_MIN_MATCH : 0;
+    *out++ = (Byte)((min(literal_length, (QWord)LZF_NIBBLE_MAX) << 4) | min(match_code, (QWord)LZF_NIBBLE_MAX));
+    out = writeLength(out, literal_length);
+    memcpy(out, literals, literal_length);
+    out += literal_length;
+    if (match_length == 0) return out;
+    out += write16To8Buf(out, (Word)offset);
+    return writeLength(out, match_code);
+}
+
+// greedy match search, one candidate per position, encoded size returned
+QWord LZFast::encodeBlock(Byte* in_bytes, QWord in_size, Byte* out) {
+    Byte* out_begin = out;
+    QWord anchor = 0, i = 0;
+    QWord limit  = in_size > LZF_MATCH_LIMIT ? in_size - LZF_MATCH_LIMIT : 0;
+    memset(lookup, 0, sizeof(Word) << LZF_HASH_BITS);
+
+    while (i < limit) {
+        DWord hash      = hashValue(in_bytes + i);
+        QWord candidate = lookup[hash];
+        lookup[hash]    = (Word)i;
+
+        // empty table entry points to 0, every candidate is compared
+        if (candidate >= i || read32From8Buf(in_bytes + candidate) != read32From8Buf(in_bytes + i)) {
+            i += 1 + ((i - anchor) >> LZF_SKIP_SHIFT);
+            continue;
+        }
+
+        // extend match forward and backward over pending literals
+        QWord length = LZF_MIN_MATCH;
+        while (i + length < in_size && in_bytes[candidate + length] == in_bytes[i + length]) length++;
+        while (i > anchor && candidate > 0 && in_bytes[i - 1] == in_bytes[candidate - 1]) {
+            i--;
+            candidate--;
+            length++;
+        }
+
+        out = writeSequence(out, in_bytes + anchor, i - anchor, i - candidate, length);
+        i += length;
+        anchor = i;
+        if (i - 2 < limit) lookup[hashValue(in_bytes + i - 2)] = (Word)(i - 2);
+    }
+
+    // rest of block as literals
+    if (anchor < in_size) out = writeSequence(out, in_bytes + anchor, in_size - anchor, 0, 0);
+    return out - out_begin;
+}
+
+QWord LZFast::compressStream(InputStreamInterface* input, OutputStreamInterface* output) {
+    clock_t clock_begin = clock();
+    CodecCallbackInfo callback_info = { 0, 0, 0, 0, 0, 0 };
+    QWord total_in_size = 0;
+
+    while (input->getPos() < input->getSize()) {
+
+        // block is borrowed from input memory when possible
+        QWord in_size(0);
+        Byte* in_bytes = input->peek(0xFFFF, &in_size);
+        if (in_bytes) {
+            input->consume(in_size);
+        } else {
+            input->read(uncompressed_bytes, 0xFFFF);
+            in_size  = input->getReadSize();
+            in_bytes = uncompressed_bytes;
+        }
+
+        // block is stored as it is when it does not get smaller
+        QWord out_size = encodeBlock(in_bytes, in_size, compressed_bytes);
+        bool  stored   = out_size + sizeof(QWord) >= in_size;
+
+        // block start for seek table
+        if (block_index) block_index->push_back({ total_in_size, output->getPos() });
+        total_in_size += in_size;
+
+        // stored block has no size of sequences
+        Byte  header[BLOCK_HEADER_MAX_SIZE + sizeof(QWord)];
+        DWord checksum    = block_checksum ? blockHash(in_bytes, in_size) : 0;
+        DWord header_size = putBlockHeader(header, block_format, stored ? BLOCK_STORED : 0, in_size,
+            block_checksum ? &checksum : nullptr);
+        if (!stored) header_size += putBlockSize(header + header_size, block_format, out_size);
+        output->write(header, header_size);
+        if (stored) {
+            output->write(in_bytes, in_size);
+            callback_info.out_size += in_size + header_size;
+        } else {
+            output->write(compressed_bytes, out_size);
+            callback_info.out_size += out_size + header_size;
+        }
+
+        // callback
+        callback_info.in_pos    = input->getPos() == -1 ? input->getSize() : input->getPos();
+        callback_info.in_size   = input->getSize();
+        callback_info.progress  = COUNTPRECENT(callback_info.in_pos,   callback_info.in_size);
+        callback_info.ratio     = COUNTPRECENT(callback_info.out_size, callback_info.in_pos);
+        callback_info.clock     = COUNTTIME(clock_begin);
+
+        if (this->callback) {
+            memcpy(&this->callback->info, &callback_info, sizeof(CodecCallbackInfo));
+            if (!this->callback->callback((input->getPos() < input->getSize()) ? CLT_PROGRESS : CLT_STREAM_FINISH))
+                break;
+        }
+    }
+
+    return callback_info.out_size;
+}
+
+// length above nibble continued by varint, false if it does not fit in block
+static bool readLength(Byte*& in, Byte* end, QWord& length) {
+    if (length < LZF_NIBBLE_MAX) return true;
+    QWord extension(0);
+    DWord bytes = readVarInt(in, end, &extension);
+    if (bytes == 0 || extension > 0xFFFF) return false;
+    in     += bytes;
+    length += extension;
+    return true;
+}
+
+// decode sequences of one block, number of decoded bytes returned, corrupted set on broken sequences
+QWord LZFast::decodeBlock(Byte* in_bytes, QWord in_size, Byte* out, QWord out_size) {
+    Byte* in  = in_bytes;
+    Byte* end = in_bytes + in_size;
+    QWord o   = 0;
+
+    while (o < out_size) {
+        if (in >= end) { corrupted = true; break; }
+        Byte  token          = *in++;
+        QWord literal_length = token >> 4;
+        QWord match_length   = token & LZF_NIBBLE_MAX;
+
+        // literals
+        if (!readLength(in, end, literal_length) ||
+            literal_length > QWord(end - in) || literal_length > out_size - o) { corrupted = true; break; }
+        memcpy(out + o, in, literal_length);
+        in += literal_length;
+        o  += literal_length;
+        if (o == out_size) break;
+
+        // match, overlapping one is copied byte by byte
+        if (end - in < (long long)sizeof(Word)) { corrupted = true; break; }
+        QWord offset = read16From8Buf(in);
+        in += sizeof(Word);
+        if (!readLength(in, end, match_length)) { corrupted = true; break; }
+        match_length += LZF_MIN_MATCH;
+        if (offset == 0 || offset > o || match_length > out_size - o) { corrupted = true; break; }
+
+        Byte* match = out + o - offset;
+        if (offset >= match_length) {
+            memcpy(out + o, match, match_length);
+        } else {
+            for (QWord j = 0; j < match_length; j++) out[o + j] = match[j];
+        }
+        o += match_length;
+    }
+
+    // whole block belongs to its sequences
+    if (in != end) corrupted = true;
+    return o;
+}
+
+QWord LZFast::decompressStream(InputStreamInterface* input, OutputStreamInterface* output) {
+    clock_t clock_begin = clock();
+    CodecCallbackInfo callback_info = { 0, 0, 0, 0, 0, 0 };
+    corrupted = false;
+
+    while (input->getPos() < input->getSize()) {
+        QWord out_size(0), in_size(0);
+        DWord checksum(0);
+        Byte  flags(0);
+
+        bool header = readBlockHeader(input, block_format, &flags, &out_size, block_checksum ? &checksum : nullptr);
+        bool stored = (flags & BLOCK_STORED) != 0;
+        if (stored) in_size = out_size;
+        else        header = header && readBlockSize(input, block_format, &in_size);
+
+        // broken block header
+        if (!header || (flags & ~BLOCK_STORED) || out_size > 0xFFFF || in_size > (0xFFFF << 1)) {
+            corrupted = true;
+            break;
+        }
+
+        // block borrowed from input memory when possible
+        Byte* in_bytes = borrowStream(input, compressed_bytes, in_size);
+        if (in_bytes == nullptr) {
+            corrupted = true;
+            break;
+        }
+
+        // stored block is checked and passed on as it is
+        if (stored) {
+            if (block_checksum && blockHash(in_bytes, out_size) != checksum) {
+                corrupted = true;
+                break;
+            }
+            output->write(in_bytes, out_size);
+        } else {
+
+            // block is decoded straight into output memory when it can be lent
+            Byte* out_bytes = output->reserve(out_size);
+            Byte* decoded   = out_bytes ? out_bytes : uncompressed_bytes;
+            QWord o         = decodeBlock(in_bytes, in_size, decoded, out_size);
+
+            // verify block before it reaches output
+            if (corrupted || o != out_size || (block_checksum && blockHash(decoded, o) != checksum)) {
+                if (out_bytes) output->commit(0);
+                corrupted = true;
+                break;
+            }
+
+            if (out_bytes) output->commit(o);
+            else           output->write(uncompressed_bytes, o);
+        }
+
+        // callback
+        callback_info.in_pos    = input->getPos() == -1 ? input->getSize() : input->getPos();
+        callback_info.in_size   = in_size + sizeof(QWord) * 2;
+        callback_info.out_size += out_size;
+        callback_info.progress  = COUNTPRECENT(callback_info.in_pos,   callback_info.in_size);
+        callback_info.ratio     = COUNTPRECENT(callback_info.out_size, callback_info.in_pos);
+        callback_info.clock     = COUNTTIME(clock_begin);
+
+        if (this->callback) {
+            memcpy(&this->callback->info, &callback_info, sizeof(CodecCallbackInfo));
+            if (!this->callback->callback((input->getPos() < input->getSize()) ? CLT_PROGRESS : CLT_STREAM_FINISH))
+                break;
+        }
+    }
+
+    return callback_info.out_size;
+}
+
+// copy one encoded block without decoding it
+bool LZFast::readBlock(InputStreamInterface* input, vector<Byte>& block) {
+    QWord size(0);
+    DWord checksum(0);
+    Byte  flags(0);
+    block.clear();
+
+    // block header
+    if (!readBlockHeader(input, block_format, &flags, &size, block_checksum ? &checksum : nullptr, &block)) return false;
+    if (flags & ~BLOCK_STORED) return false;
+
+    // stored data or sequences
+    if (flags & BLOCK_STORED) return size <= 0xFFFF && appendStream(input, block, size);
+    if (!readBlockSize(input, block_format, &size, &block)) return false;
+    return size <= (0xFFFF << 1) && appendStream(input, block, size);
+}
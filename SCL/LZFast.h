@@ -0,0 +1,46 @@
+////////////////////////////////////////////
+// Small Compression Library              //
+// author: Mariusz Ziach                  //
+// www   : http://ziach.pl/               //
+// date  : 2020                           //
+////////////////////////////////////////////
+
+#ifndef SCL_LZFAST_H
+#define SCL_LZFAST_H
+
+// Archive
+#include "Types.h"
+#include "Utils.h"
+#include "Streams.h"
+#include "Hashing.h"
+
+// sequence token - literal length in high nibble, match length in low nibble,
+// nibble value LZF_NIBBLE_MAX is continued by varint
+#define LZF_NIBBLE_MAX  15
+#define LZF_MIN_MATCH   4   // match length stored is length - LZF_MIN_MATCH
+#define LZF_HASH_BITS   13  // positions of 4-byte values in lookup table
+#define LZF_MATCH_LIMIT 12  // no match starts in last bytes of block
+#define LZF_SKIP_SHIFT  6   // search step grows by one every 2^shift bytes without match
+
+namespace SCL {
+
+// LZ without entropy coding, block is sequence of [token][literal length][literals][offset][match length],
+// last sequence has literals only - fast tier, decoder copies whole literal runs and matches
+class LZFast : public CodecInterface {
+private:
+    Byte* uncompressed_bytes;
+    Byte* compressed_bytes;
+    Word* lookup;
+    QWord encodeBlock(Byte* in_bytes, QWord in_size, Byte* out);
+    QWord decodeBlock(Byte* in_bytes, QWord in_size, Byte* out, QWord out_size);
+public:
+    LZFast();
+    ~LZFast();
+    QWord compressStream  (InputStreamInterface* input, OutputStreamInterface* output);
+    QWord decompressStream(InputStreamInterface* input, OutputStreamInterface* output);
+    bool  readBlock(InputStreamInterface* input, vector<Byte>& block);
+};
+
+} // namespace
+
+#endif // SCL_LZFAST_H
@@ -67,6 +67,7 @@ bool LZHuffmanCodecCallback::callback(CallbackType callback_type) {
 LZHuffman::LZHuffman(LZCompressionLevel comp_level) {
     lz_codec         = new LZ(comp_level);
     huffman_codec    = new Huffman;
+    parent_callback  = nullptr;
     lz_callback      = nullptr;
     huffman_callback = nullptr;
 }
@@ -94,9 +95,32 @@ void LZHuffman::setCallback(CodecCallbackInterface* callback) {
     huffman_codec->setCallback(this->huffman_callback);
 }
 
+// checksum is stored in LZ blocks only, it covers huffman records too
+void LZHuffman::setBlockChecksum(bool block_checksum) {
+    this->block_checksum = block_checksum;
+    lz_codec->setBlockChecksum(block_checksum);
+}
+
+// LZ blocks are the only ones which can be decoded independently
+void LZHuffman::setBlockIndex(vector<BlockPosition>* block_index) {
+    this->block_index = block_index;
+    lz_codec->setBlockIndex(block_index);
+}
+
+// both codecs write blocks of the same format
+void LZHuffman::setBlockFormat(BlockFormat block_format) {
+    this->block_format = block_format;
+    lz_codec     ->setBlockFormat(block_format);
+    huffman_codec->setBlockFormat(block_format);
+}
+
+bool LZHuffman::isCorrupted() {
+    return lz_codec->isCorrupted() || huffman_codec->isCorrupted();
+}
+
 QWord LZHuffman::compressStream(InputStreamInterface* input, OutputStreamInterface* output) {
-    this->lz_callback     ->init(true);
-    this->huffman_callback->init(true);
+    if (this->lz_callback)      this->lz_callback     ->init(true);
+    if (this->huffman_callback) this->huffman_callback->init(true);
 
     CodecOutputStream huffman_output(input, output, huffman_codec);
 
@@ -108,9 +132,68 @@ QWord LZHuffman::compressStream(InputStreamInterface* input, OutputStreamInterfa
 }
 
 QWord LZHuffman::decompressStream(InputStreamInterface* input, OutputStreamInterface* output) {
-    this->lz_callback     ->init(false);
-    this->huffman_callback->init(false);
+    if (this->lz_callback)      this->lz_callback     ->init(false);
+    if (this->huffman_callback) this->huffman_callback->init(false);
 
     CodecInputStream huffman_input(input, output, huffman_codec);
     return lz_codec->decompressStream(&huffman_input, output);
 }
+
+// every LZ write is a separate huffman record: [compressed size][huffman stream], or one
+// compact huffman block, first record holds LZ block header which tells whether block is stored
+bool LZHuffman::readBlock(InputStreamInterface* input, vector<Byte>& block) {
+    if (block_format == BF_COMPACT) return readCompactBlock(input, block);
+
+    DWord records = 1 + LZ_NUMBER_OF_STREAMS * 2 + (block_checksum ? 1 : 0);
+    QWord size(0), block_size(0);
+    block.clear();
+
+    for (DWord r = 0; r < records; r++) {
+        if (!appendStream(input, block, sizeof(QWord))) return false;
+        memcpy(&size, block.data() + block.size() - sizeof(QWord), sizeof(QWord));
+        if (size > (0xFFFF << 1) || !appendStream(input, block, size)) return false;
+
+        // record is decoded without reporting progress, block is only copied
+        if (r == 0) {
+            MemoryInputStream  record(block.data() + sizeof(QWord), size);
+            MemoryOutputStream decoded((Byte*)&block_size, sizeof(QWord));
+            huffman_codec->setCallback(nullptr);
+            QWord decoded_size = huffman_codec->decompressStream(&record, &decoded);
+            huffman_codec->setCallback(huffman_callback);
+            if (decoded_size != sizeof(QWord)) return false;
+            if (block_size & STORED_BLOCK) records = 1 + (block_checksum ? 1 : 0) + 1;
+        }
+    }
+    return true;
+}
+
+// flags byte of LZ header tells which writes follow it - stored data or streams which are not empty,
+// none of them is larger than block, each one is single huffman block
+bool LZHuffman::readCompactBlock(InputStreamInterface* input, vector<Byte>& block) {
+    vector<Byte> record;
+    Byte  header[LZ_HEADER_MAX_SIZE];
+    block.clear();
+
+    // header is decoded without reporting progress, block is only copied
+    if (!huffman_codec->readBlock(input, record)) return false;
+    MemoryInputStream  header_input(record.data(), record.size());
+    MemoryOutputStream header_output(header, sizeof(header));
+    huffman_codec->setCallback(nullptr);
+    QWord header_size = huffman_codec->decompressStream(&header_input, &header_output);
+    huffman_codec->setCallback(huffman_callback);
+    if (header_size == 0 || huffman_codec->isCorrupted()) return false;
+    block.insert(block.end(), record.begin(), record.end());
+
+    DWord records = 1;
+    if (!(header[0] & BLOCK_STORED)) {
+        records = 0;
+        for (int j = 0; j < LZ_NUMBER_OF_STREAMS; j++) {
+            if (!(header[0] & (BLOCK_EMPTY_STREAM << j))) records++;
+        }
+    }
+    for (DWord r = 0; r < records; r++) {
+        if (!huffman_codec->readBlock(input, record)) return false;
+        block.insert(block.end(), record.begin(), record.end());
+    }
+    return true;
+}
@@ -38,13 +38,19 @@ private:
     CodecCallbackInterface* parent_callback;
     LZHuffmanCodecCallback* huffman_callback;
     LZHuffmanCodecCallback* lz_callback;
+    bool readCompactBlock(InputStreamInterface* input, vector<Byte>& block);
 
 public:
     LZHuffman(LZCompressionLevel comp_level = LCL_NORMAL);
     ~LZHuffman();
     void setCallback(CodecCallbackInterface* callback);
+    void setBlockChecksum(bool block_checksum);
+    void setBlockIndex(vector<BlockPosition>* block_index);
+    void setBlockFormat(BlockFormat block_format);
+    bool isCorrupted();
     QWord compressStream  (InputStreamInterface* input, OutputStreamInterface* output);
     QWord decompressStream(InputStreamInterface* input, OutputStreamInterface* output);
+    bool  readBlock(InputStreamInterface* input, vector<Byte>& block);
 };
 }
 #endif // SCL_LZHUFFMAN_H
@@ -0,0 +1,121 @@
+////////////////////////////////////////////
+// Small Compression Library              //
+// author: Mariusz Ziach                  //
+// www   : http://ziach.pl/               //
+// date  : 2020                           //
+////////////////////////////////////////////
+
+#include "Store.h"
+
+using namespace SCL;
+
+Store::Store() {
+    uncompressed_bytes = new Byte[0xFFFF];
+}
+
+Store::~Store() {
+    if (uncompressed_bytes) delete[] uncompressed_bytes;
+}
+
+QWord Store::compressStream(InputStreamInterface* input, OutputStreamInterface* output) {
+    clock_t clock_begin = clock();
+    CodecCallbackInfo callback_info = { 0, 0, 0, 0, 0, 0 };
+    QWord total_in_size = 0;
+
+    while (input->getPos() < input->getSize()) {
+
+        // block is borrowed from input memory when possible
+        QWord in_size(0);
+        Byte* in_bytes = input->peek(0xFFFF, &in_size);
+        if (in_bytes) {
+            input->consume(in_size);
+        } else {
+            input->read(uncompressed_bytes, 0xFFFF);
+            in_size  = input->getReadSize();
+            in_bytes = uncompressed_bytes;
+        }
+
+        // block start for seek table
+        if (block_index) block_index->push_back({ total_in_size, output->getPos() });
+        total_in_size += in_size;
+
+        Byte  header[BLOCK_HEADER_MAX_SIZE];
+        DWord checksum    = block_checksum ? blockHash(in_bytes, in_size) : 0;
+        DWord header_size = putBlockHeader(header, block_format, BLOCK_STORED, in_size, block_checksum ? &checksum : nullptr);
+        output->write(header, header_size);
+        output->write(in_bytes, in_size);
+        callback_info.out_size += in_size + header_size;
+
+        // callback
+        callback_info.in_pos    = input->getPos() == -1 ? input->getSize() : input->getPos();
+        callback_info.in_size   = input->getSize();
+        callback_info.progress  = COUNTPRECENT(callback_info.in_pos,   callback_info.in_size);
+        callback_info.ratio     = COUNTPRECENT(callback_info.out_size, callback_info.in_pos);
+        callback_info.clock     = COUNTTIME(clock_begin);
+
+        if (this->callback) {
+            memcpy(&this->callback->info, &callback_info, sizeof(CodecCallbackInfo));
+            if (!this->callback->callback((input->getPos() < input->getSize()) ? CLT_PROGRESS : CLT_STREAM_FINISH))
+                break;
+        }
+    }
+
+    return callback_info.out_size;
+}
+
+QWord Store::decompressStream(InputStreamInterface* input, OutputStreamInterface* output) {
+    clock_t clock_begin = clock();
+    CodecCallbackInfo callback_info = { 0, 0, 0, 0, 0, 0 };
+    corrupted = false;
+
+    while (input->getPos() < input->getSize()) {
+        QWord out_size(0);
+        DWord checksum(0);
+        Byte  flags(0);
+
+        // broken block header
+        if (!readBlockHeader(input, block_format, &flags, &out_size, block_checksum ? &checksum : nullptr) ||
+            flags != BLOCK_STORED || out_size > 0xFFFF) {
+            corrupted = true;
+            break;
+        }
+
+        // data borrowed from input memory when possible, checked before it reaches output
+        Byte* out_bytes = borrowStream(input, uncompressed_bytes, out_size);
+        if (out_bytes == nullptr || (block_checksum && blockHash(out_bytes, out_size) != checksum)) {
+            corrupted = true;
+            break;
+        }
+        output->write(out_bytes, out_size);
+
+        // callback
+        callback_info.in_pos    = input->getPos() == -1 ? input->getSize() : input->getPos();
+        callback_info.in_size   = out_size + sizeof(QWord);
+        callback_info.out_size += out_size;
+        callback_info.progress  = COUNTPRECENT(callback_info.in_pos,   callback_info.in_size);
+        callback_info.ratio     = COUNTPRECENT(callback_info.out_size, callback_info.in_pos);
+        callback_info.clock     = COUNTTIME(clock_begin);
+
+        if (this->callback) {
+            memcpy(&this->callback->info, &callback_info, sizeof(CodecCallbackInfo));
+            if (!this->callback->callback((input->getPos() < input->getSize()) ? CLT_PROGRESS : CLT_STREAM_FINISH))
+                break;
+        }
+    }
+
+    return callback_info.out_size;
+}
+
+// copy one block without checking it
+bool Store::readBlock(InputStreamInterface* input, vector<Byte>& block) {
+    QWord size(0);
+    DWord checksum(0);
+    Byte  flags(0);
+    block.clear();
+
+    // block header
+    if (!readBlockHeader(input, block_format, &flags, &size, block_checksum ? &checksum : nullptr, &block)) return false;
+
+    // data
+    return flags == BLOCK_STORED && size <= 0xFFFF && appendStream(input, block, size);
+}
@@ -0,0 +1,33 @@
+////////////////////////////////////////////
+// Small Compression Library              //
+// author: Mariusz Ziach                  //
+// www   : http://ziach.pl/               //
+// date  : 2020                           //
+////////////////////////////////////////////
+
+#ifndef SCL_STORE_H
+#define SCL_STORE_H
+
+// Archive
+#include "Types.h"
+#include "Utils.h"
+#include "Streams.h"
+#include "Hashing.h"
+
+namespace SCL {
+
+// data kept as it is, in blocks laid out as stored LZ blocks: [size | STORED_BLOCK][checksum][data]
+class Store : public CodecInterface {
+private:
+    Byte* uncompressed_bytes;
+public:
+    Store();
+    ~Store();
+    QWord compressStream  (InputStreamInterface* input, OutputStreamInterface* output);
+    QWord decompressStream(InputStreamInterface* input, OutputStreamInterface* output);
+    bool  readBlock(InputStreamInterface* input, vector<Byte>& block);
+};
+
+} // namespace
+
+#endif // SCL_STORE_H
@@ -40,6 +40,13 @@ QWord OutputStreamInterface::getWrittenSize() {
     return this->written_size;
 }
 
+// streams without own memory always take the copying path
+Byte* OutputStreamInterface::reserve(QWord) {
+    return nullptr;
+}
+
+void OutputStreamInterface::commit(QWord) {}
+
 // reader stream
 InputStreamInterface::~InputStreamInterface() {}
 
@@ -51,6 +58,13 @@ QWord InputStreamInterface::getReadSize() {
     return this->read_size;
 }
 
+Byte* InputStreamInterface::peek(QWord, QWord* available) {
+    *available = 0;
+    return nullptr;
+}
+
+void InputStreamInterface::consume(QWord) {}
+
 // memory reader
 MemoryInputStream::MemoryInputStream(Byte* mem, QWord size) {
     this->mem = mem;
@@ -58,18 +72,34 @@ MemoryInputStream::MemoryInputStream(Byte* mem, QWord size) {
 }
 
 bool MemoryInputStream::read(Byte* buf, QWord size) {
-    QWord i;
-    for (i = 0; i < size; i++) {
-        if (this->pos + i >= this->size) {
-            break;
-        }
-        buf[i] = this->mem[this->pos + i];
-    }
-    this->read_size = i;
-    this->pos += i;
+    QWord left = this->pos < this->size ? this->size - this->pos : 0;
+    this->read_size = size < left ? size : left;
+    if (this->read_size > 0) memcpy(buf, this->mem + this->pos, this->read_size);
+    this->pos += this->read_size;
     return true;
 }
 
+Byte* MemoryInputStream::peek(QWord size, QWord* available) {
+    QWord left = this->pos < this->size ? this->size - this->pos : 0;
+    *available = size < left ? size : left;
+    return this->mem + this->pos;
+}
+
+void MemoryInputStream::consume(QWord size) {
+    QWord left = this->pos < this->size ? this->size - this->pos : 0;
+    this->read_size = size < left ? size : left;
+    this->pos += this->read_size;
+}
+
+// mapped file reader, part is clipped to end of file
+static QWord mappedPart(MappedFile* file, QWord pos, QWord size) {
+    if (pos >= file->getSize()) return 0;
+    return size < file->getSize() - pos ? size : file->getSize() - pos;
+}
+
+MappedInputStream::MappedInputStream(MappedFile* file, QWord pos, QWord size)
+    : MemoryInputStream(file->getData() + (pos < file->getSize() ? pos : 0), mappedPart(file, pos, size)) {}
+
 // memory writer
 MemoryOutputStream::MemoryOutputStream(Byte* mem, QWord size) {
     this->mem  = mem;
@@ -77,23 +107,120 @@ MemoryOutputStream::MemoryOutputStream(Byte* mem, QWord size) {
 }
 
 bool MemoryOutputStream::write(Byte* buf, QWord size) {
-    QWord i;
-    for (i = 0; i < size; i++) {
-        if (this->pos + i >= this->size)  break;
-        this->mem[this->pos + i] = buf[i];
-    }
-
-    this->written_size = i;
+    QWord left = this->pos < this->size ? this->size - this->pos : 0;
+    this->written_size = size < left ? size : left;
+    if (this->written_size > 0) memcpy(this->mem + this->pos, buf, this->written_size);
     this->pos += this->written_size;
+    return true;
+}
+
+// lent only when whole reservation fits, otherwise write truncates as usual
+Byte* MemoryOutputStream::reserve(QWord size) {
+    if (this->pos > this->size || size > this->size - this->pos) return nullptr;
+    return this->mem + this->pos;
+}
 
+void MemoryOutputStream::commit(QWord size) {
+    this->written_size = size;
+    this->pos += size;
+}
+
+// buffer writer
+BufferOutputStream::BufferOutputStream(vector<Byte>* buf) {
+    this->buf  = buf;
+    this->size = buf->size();
+}
+
+bool BufferOutputStream::write(Byte* buf, QWord size) {
+    if (this->pos + size > this->buf->size()) this->buf->resize(this->pos + size);
+    if (size > 0) memcpy(this->buf->data() + this->pos, buf, size);
+    this->written_size = size;
+    this->pos += size;
+    this->size = this->buf->size();
     return true;
 }
 
+// buffer grows for reservation and is trimmed back to written data on commit
+Byte* BufferOutputStream::reserve(QWord size) {
+    if (this->pos + size > this->buf->size()) this->buf->resize(this->pos + size);
+    return this->buf->data() + this->pos;
+}
+
+void BufferOutputStream::commit(QWord size) {
+    this->written_size = size;
+    this->pos += size;
+    if (this->pos > this->size) this->size = this->pos;
+    this->buf->resize(this->size);
+}
+
+// counting reader
+CountingInputStream::CountingInputStream(InputStreamInterface* input, atomic<QWord>* counter) {
+    this->input   = input;
+    this->counter = counter;
+}
+
+bool CountingInputStream::read(Byte* buf, QWord size) {
+    bool ret = input->read(buf, size);
+    this->read_size = input->getReadSize();
+    *counter += this->read_size;
+    return ret;
+}
+
+void CountingInputStream::setPos(QWord pos) {
+    input->setPos(pos);
+}
+
+QWord CountingInputStream::getPos() {
+    return input->getPos();
+}
+
+QWord CountingInputStream::getSize() {
+    return input->getSize();
+}
+
+// null writer
+NullOutputStream::NullOutputStream() {}
+
+bool NullOutputStream::write(Byte*, QWord size) {
+    this->written_size = size;
+    this->pos  += size;
+    this->size += size;
+    return true;
+}
+
+// skip writer
+SkipOutputStream::SkipOutputStream(OutputStreamInterface* output, QWord skip) {
+    this->output = output;
+    this->skip   = skip;
+}
+
+bool SkipOutputStream::write(Byte* buf, QWord size) {
+    QWord skipped = size < skip ? size : skip;
+    skip -= skipped;
+    this->pos  += size;
+    this->size += size;
+    this->written_size = size;
+    if (skipped == size) return true;
+    return output->write(buf + skipped, size - skipped);
+}
+
+// skipped part has nowhere to go, memory is lent only after it
+Byte* SkipOutputStream::reserve(QWord size) {
+    return skip == 0 ? output->reserve(size) : nullptr;
+}
+
+void SkipOutputStream::commit(QWord size) {
+    output->commit(size);
+    this->pos  += size;
+    this->size += size;
+    this->written_size = size;
+}
+
 // file reader
 FileInputStream::FileInputStream(char* file_name) {
     this->ifs = new ifstream(file_name, ifstream::binary);
     this->ifs->seekg(0, ios::end);
-    this->size = (DWord)this->ifs->tellg();
+    this->size = (QWord)this->ifs->tellg();
     this->ifs->seekg(0, ios::beg);
     this->created = true;
 }
@@ -102,7 +229,7 @@ FileInputStream::FileInputStream(ifstream* ifs) {
     this->ifs = ifs;
     streampos temp = this->ifs->tellg();
     this->ifs->seekg(0, ios::end);
-    this->size = (DWord)this->ifs->tellg();
+    this->size = (QWord)this->ifs->tellg();
     this->ifs->seekg(temp, ios::beg);
     this->created = false;
 }
@@ -134,40 +261,156 @@ QWord FileInputStream::getPos() {
 FileOutputStream::FileOutputStream(char* file_name) {
     this->ofs = new ofstream(file_name, ofstream::binary);
     this->created = true;
+    init();
 }
 
 FileOutputStream::FileOutputStream(ofstream* ofs) {
     this->ofs = ofs;
     this->created = false;
+    init();
 }
 
 FileOutputStream::~FileOutputStream() {
+    flush();
     if (this->created)
         delete this->ofs;
 }
 
-bool FileOutputStream::write(Byte* buf, QWord size) {
-    QWord before = (QWord)this->ofs->tellp();
-    this->ofs->write((char*)buf, size);
-    this->pos = (QWord)this->ofs->tellp();
-    this->written_size = this->pos - before;
-
+// position and size are read from file once, later they are tracked here,
+// buffer is allocated with first write
+void FileOutputStream::init() {
+    streampos begin = this->ofs->tellp();
+    this->file_pos = begin == streampos(-1) ? 0 : (QWord)begin;
     this->ofs->seekp(0, ios::end);
-    this->size = (QWord)this->ofs->tellp();
-    this->ofs->seekp(this->pos);
+    streampos end = this->ofs->tellp();
+    this->size = end == streampos(-1) ? this->file_pos : (QWord)end;
+    this->ofs->seekp(this->file_pos);
+    this->pos = this->file_pos;
+    this->buffer_pos  = this->pos;
+    this->buffer_used = 0;
+}
+
+// seek only if file is not already there
+bool FileOutputStream::writeFile(QWord pos, Byte* buf, QWord size) {
+    if (size == 0) return true;
+    if (pos != this->file_pos) this->ofs->seekp(pos);
+    this->ofs->write((char*)buf, size);
+    this->file_pos = pos + size;
+    return this->ofs->good();
+}
 
-    return true;
+// size bytes at current position fit into buffer without leaving a gap
+bool FileOutputStream::inBuffer(QWord size) {
+    return this->pos >= this->buffer_pos && this->pos <= this->buffer_pos + this->buffer_used &&
+           this->pos - this->buffer_pos + size <= this->buffer.size();
 }
 
-void FileOutputStream::setPos(QWord pos) {
-    this->ofs->clear();
-    this->ofs->seekp(pos, ios::beg);
-    this->pos = (DWord)this->ofs->tellp();
+bool FileOutputStream::flush() {
+    bool ret = writeFile(this->buffer_pos, this->buffer.data(), this->buffer_used);
+    this->buffer_pos  = this->pos;
+    this->buffer_used = 0;
+    return ret;
 }
 
-QWord FileOutputStream::getPos() {
-    this->pos = (DWord)this->ofs->tellp();
-    return this->pos;
+bool FileOutputStream::write(Byte* buf, QWord size) {
+    bool ret = true;
+    if (this->buffer.empty()) this->buffer.resize(FILE_STREAM_BUFFER_SIZE);
+    if (!inBuffer(size)) {
+        if (this->pos + size <= this->buffer_pos) {
+            // back-patch of data already written to file
+            ret = writeFile(this->pos, buf, size);
+            size = ret ? size : 0;
+            buf  = nullptr;
+        } else {
+            ret = flush();
+            if (size >= this->buffer.size()) {
+                ret  = ret && writeFile(this->pos, buf, size);
+                size = ret ? size : 0;
+                buf  = nullptr;
+            }
+        }
+    }
+    if (buf && size > 0) {
+        memcpy(this->buffer.data() + (this->pos - this->buffer_pos), buf, size);
+        QWord used = this->pos - this->buffer_pos + size;
+        if (used > this->buffer_used) this->buffer_used = used;
+    }
+    this->written_size = size;
+    this->pos += size;
+    if (this->pos > this->size) this->size = this->pos;
+    return ret;
+}
+
+// codecs can encode straight into write buffer
+Byte* FileOutputStream::reserve(QWord size) {
+    if (this->buffer.empty()) this->buffer.resize(FILE_STREAM_BUFFER_SIZE);
+    if (size > this->buffer.size()) return nullptr;
+    if (!inBuffer(size) && !flush()) return nullptr;
+    return this->buffer.data() + (this->pos - this->buffer_pos);
+}
+
+void FileOutputStream::commit(QWord size) {
+    QWord used = this->pos - this->buffer_pos + size;
+    if (used > this->buffer_used) this->buffer_used = used;
+    this->written_size = size;
+    this->pos += size;
+    if (this->pos > this->size) this->size = this->pos;
+}
+
+// prefetch reader, blocks go around between reader thread and consumer
+PrefetchInputStream::PrefetchInputStream(InputStreamInterface* input, DWord block_count, QWord block_size)
+    : filled_blocks(block_count), free_blocks(block_count) {
+    this->input       = input;
+    this->size        = input->getSize();
+    this->current     = { vector<Byte>(), 0 };
+    this->current_pos = 0;
+    this->finished    = false;
+    for (DWord i = 0; i < block_count; i++) free_blocks.push({ vector<Byte>(block_size), 0 });
+    reader = thread(&PrefetchInputStream::readAhead, this);
+}
+
+PrefetchInputStream::~PrefetchInputStream() {
+    free_blocks.close();
+    filled_blocks.close();
+    reader.join();
+}
+
+// reader thread, short block marks end of input
+void PrefetchInputStream::readAhead() {
+    PrefetchBlock block;
+    while (free_blocks.pop(block)) {
+        input->read(block.data.data(), block.data.size());
+        block.size = input->getReadSize();
+        bool last  = block.size < block.data.size();
+        if (!filled_blocks.push(move(block)) || last) break;
+    }
+    filled_blocks.close();
+}
+
+bool PrefetchInputStream::read(Byte* buf, QWord size) {
+    QWord done = 0;
+    while (done < size && !finished) {
+        // take next block, finished one goes back to reader
+        if (current_pos == current.size) {
+            if (!current.data.empty()) free_blocks.push(move(current));
+            current_pos = 0;
+            if (!filled_blocks.pop(current)) {
+                current  = { vector<Byte>(), 0 };
+                finished = true;
+            }
+            continue;
+        }
+        QWord part = min(size - done, current.size - current_pos);
+        memcpy(buf + done, current.data.data() + current_pos, part);
+        current_pos += part;
+        done        += part;
+    }
+    this->read_size = done;
+    this->pos      += done;
+
+    // input was shorter than expected, codecs stop at its real end
+    if (finished) this->size = this->pos;
+    return true;
 }
 
 // codec stream
@@ -192,9 +435,19 @@ QWord CodecOutputStream::getSize() {
 
 bool CodecOutputStream::write(Byte* buf, QWord size) {
     MemoryInputStream mrs(buf, size);
+    QWord begin = output->getPos();
+
+    // compact blocks are written as they are, nothing is patched
+    if (codec->getBlockFormat() == BF_COMPACT) {
+        codec->compressStream(&mrs, output);
+        this->size = output->getSize();
+        this->pos = output->getPos();
+        this->written_size = this->pos - begin;
+        return true;
+    }
     
     // temp write size
-    QWord temp0 = output->getPos();
+    QWord temp0 = begin;
     output->write((Byte*)&size, sizeof(QWord));
     QWord temp1 = output->getPos();
     
@@ -223,6 +476,8 @@ CodecInputStream::CodecInputStream(InputStreamInterface* input, OutputStreamInte
     this->mem = new Byte[0xFFFF << 1];
     this->size = input->getSize();
     this->pos = 0;
+    this->block_pos = 0;
+    this->block_size = 0;
 }
 
 CodecInputStream::~CodecInputStream() {
@@ -237,14 +492,25 @@ QWord CodecInputStream::getPos() {
     return this->pos;
 }
 
-bool CodecInputStream::read(Byte* buf, QWord size) {
+// one fixed record is decoded by every read
+bool CodecInputStream::readRecord(Byte* buf, QWord size) {
     QWord csize(0);
     input->read((Byte*)&csize, sizeof(QWord));
-    input->read((Byte*)mem, csize);
 
-    MemoryInputStream  mem_in(mem, csize);
+    // record is decoded straight from input memory when it can be borrowed
+    Byte* record = nullptr;
+    if (input->getReadSize() == sizeof(QWord) && csize <= (0xFFFF << 1))
+        record = borrowStream(input, mem, csize);
+
+    // broken record, stop reading
+    if (record == nullptr) {
+        this->read_size = 0;
+        this->pos = this->size;
+        return false;
+    }
+
+    MemoryInputStream  mem_in(record, csize);
     MemoryOutputStream mem_out(buf, size);
-    //printf("[isize: %lli;; size: %lli]\n", input->getSize(), size);
 
     this->read_size = codec->decompressStream(&mem_in, &mem_out);
     this->pos += csize + sizeof(QWord);
@@ -252,6 +518,42 @@ bool CodecInputStream::read(Byte* buf, QWord size) {
     return true;
 }
 
+// next compact block, broken block stops reading
+bool CodecInputStream::loadBlock() {
+    block_pos = block_size = 0;
+    if (this->pos >= this->size) return false;
+
+    if (codec->readBlock(input, block)) {
+        MemoryInputStream  block_in(block.data(), block.size());
+        MemoryOutputStream block_out(mem, 0xFFFF << 1);
+        block_size = codec->decompressStream(&block_in, &block_out);
+    }
+    if (block_size == 0 || codec->isCorrupted()) {
+        block_size = 0;
+        this->pos = this->size;
+        return false;
+    }
+    return true;
+}
+
+bool CodecInputStream::read(Byte* buf, QWord size) {
+    if (codec->getBlockFormat() == BF_FIXED) return readRecord(buf, size);
+
+    QWord done = 0;
+    while (done < size) {
+        if (block_pos == block_size && !loadBlock()) break;
+        QWord part = min(size - done, block_size - block_pos);
+        memcpy(buf + done, mem + block_pos, part);
+        block_pos += part;
+        done      += part;
+
+        // position moves past block when all of its data is taken
+        if (block_pos == block_size) this->pos += block.size();
+    }
+    this->read_size = done;
+    return done == size;
+}
+
 // file part stream
 FilePartInputStream::FilePartInputStream(ifstream* ifs, QWord size) : FileInputStream(ifs) {
     this->size = size;
@@ -261,4 +563,83 @@ FilePartOutputStream::FilePartOutputStream(ofstream* ofs, QWord size) : FileOutp
     this->size = size;
 }
 
+// append raw bytes from stream to buffer
+bool appendStream(InputStreamInterface* input, vector<Byte>& buf, QWord size) {
+    QWord begin = buf.size();
+    buf.resize(begin + size);
+    if (size == 0) return true;
+    input->read(buf.data() + begin, size);
+    return input->getReadSize() == size;
+}
+
+// borrow bytes from input memory, copy them only when input can not lend it
+Byte* borrowStream(InputStreamInterface* input, Byte* buf, QWord size) {
+    QWord available(0);
+    Byte* mem = input->peek(size, &available);
+    if (mem != nullptr) {
+        if (available < size) return nullptr;
+        input->consume(size);
+        return mem;
+    }
+    input->read(buf, size);
+    return input->getReadSize() == size ? buf : nullptr;
+}
+
+// read exactly size bytes, copy them to block if given
+bool readStream(InputStreamInterface* input, Byte* buf, QWord size, vector<Byte>* block) {
+    input->read(buf, size);
+    if (input->getReadSize() != size) return false;
+    if (block) block->insert(block->end(), buf, buf + size);
+    return true;
+}
+
+// block header
+DWord putBlockHeader(Byte* buf, BlockFormat format, Byte flags, QWord size, DWord* checksum) {
+    DWord header_size = 0;
+    if (format == BF_COMPACT) {
+        buf[header_size++] = flags;
+        header_size += writeVarInt(buf + header_size, size);
+    } else {
+        if (flags & BLOCK_STORED) size |= STORED_BLOCK;
+        memcpy(buf, &size, sizeof(QWord));
+        header_size += sizeof(QWord);
+    }
+    if (checksum) {
+        memcpy(buf + header_size, checksum, sizeof(DWord));
+        header_size += sizeof(DWord);
+    }
+    return header_size;
+}
+
+bool readBlockHeader(InputStreamInterface* input, BlockFormat format, Byte* flags, QWord* size, DWord* checksum,
+    vector<Byte>* block) {
+    if (format == BF_COMPACT) {
+        if (!readStream(input, flags, 1, block) || !readBlockSize(input, format, size, block)) return false;
+    } else {
+        if (!readStream(input, (Byte*)size, sizeof(QWord), block)) return false;
+        *flags = (*size & STORED_BLOCK) ? BLOCK_STORED : 0;
+        *size &= ~STORED_BLOCK;
+    }
+    return !checksum || readStream(input, (Byte*)checksum, sizeof(DWord), block);
+}
+
+// size of block data
+DWord putBlockSize(Byte* buf, BlockFormat format, QWord size) {
+    if (format == BF_COMPACT) return writeVarInt(buf, size);
+    memcpy(buf, &size, sizeof(QWord));
+    return sizeof(QWord);
+}
+
+// varint is read byte by byte, it must not take bytes behind it
+bool readBlockSize(InputStreamInterface* input, BlockFormat format, QWord* size, vector<Byte>* block) {
+    if (format == BF_FIXED) return readStream(input, (Byte*)size, sizeof(QWord), block);
+
+    Byte bytes[VARINT_MAX_SIZE];
+    for (DWord i = 0; i < VARINT_MAX_SIZE; i++) {
+        if (!readStream(input, bytes + i, 1, block)) return false;
+        if (!(bytes[i] & 0x80)) return readVarInt(bytes, bytes + i + 1, size) == i + 1;
+    }
+    return false;
+}
+
 }
@@ -8,11 +8,24 @@
 #ifndef SCL_STREAMS_H
 #define SCL_STREAMS_H
 
+// C++
+#include <atomic>
+#include <thread>
+
 // Archive
 #include "Types.h"
+#include "Utils.h"
+#include "WorkQueue.h"
 
 namespace SCL {
 
+// write buffer of file output stream
+const QWord FILE_STREAM_BUFFER_SIZE = 0x100000;
+
+// blocks read ahead by prefetch stream
+const DWord PREFETCH_BLOCK_COUNT = 4;
+const QWord PREFETCH_BLOCK_SIZE  = 0x100000;
+
 // streams
 class StreamInterface {
 protected:
@@ -33,6 +46,10 @@ public:
     OutputStreamInterface();
     virtual bool write(Byte* buf, QWord size) = 0;
     virtual QWord getWrittenSize();
+    // zero-copy writing - memory for next size bytes, nullptr if stream can not lend it,
+    // every reserve is closed by commit with number of bytes actually written there
+    virtual Byte* reserve(QWord size);
+    virtual void  commit(QWord size);
 };
 
 class InputStreamInterface : public StreamInterface {
@@ -43,6 +60,10 @@ public:
     InputStreamInterface();
     virtual bool read(Byte* buf, QWord size) = 0;
     virtual QWord getReadSize();
+    // zero-copy reading - memory of next bytes (at most size, count in available), nullptr if
+    // stream can not lend it, memory stays valid while stream data exists, consume moves past it
+    virtual Byte* peek(QWord size, QWord* available);
+    virtual void  consume(QWord size);
 };
 
 class MemoryStream {
@@ -51,16 +72,69 @@ protected:
 };
 
 // memory stream
-class MemoryInputStream : public InputStreamInterface, MemoryStream {
+class MemoryInputStream : public InputStreamInterface, protected MemoryStream {
 public:
     MemoryInputStream(Byte* mem, QWord size);
     virtual bool read(Byte* buf, QWord size);
+    virtual Byte* peek(QWord size, QWord* available);
+    virtual void  consume(QWord size);
 };
 
 class MemoryOutputStream : public OutputStreamInterface, MemoryStream {
 public:
     MemoryOutputStream(Byte* mem, QWord size);
     virtual bool write(Byte* buf, QWord size);
+    virtual Byte* reserve(QWord size);
+    virtual void  commit(QWord size);
+};
+
+// mapped file stream - part of memory mapped file, read without system calls
+class MappedInputStream : public MemoryInputStream {
+public:
+    MappedInputStream(MappedFile* file, QWord pos, QWord size);
+};
+
+// buffer stream - memory output growing with written data
+class BufferOutputStream : public OutputStreamInterface {
+private:
+    vector<Byte>* buf;
+public:
+    BufferOutputStream(vector<Byte>* buf);
+    virtual bool write(Byte* buf, QWord size);
+    virtual Byte* reserve(QWord size);
+    virtual void  commit(QWord size);
+};
+
+// counting stream - adds number of read bytes to shared counter (progress of worker threads)
+class CountingInputStream : public InputStreamInterface {
+private:
+    InputStreamInterface* input;
+    atomic<QWord>* counter;
+public:
+    CountingInputStream(InputStreamInterface* input, atomic<QWord>* counter);
+    virtual bool read(Byte* buf, QWord size);
+    virtual void setPos(QWord pos);
+    virtual QWord getPos();
+    virtual QWord getSize();
+};
+
+// null stream - counts and drops written data
+class NullOutputStream : public OutputStreamInterface {
+public:
+    NullOutputStream();
+    virtual bool write(Byte* buf, QWord size);
+};
+
+// skip stream - drops first bytes of data and passes the rest to output
+class SkipOutputStream : public OutputStreamInterface {
+private:
+    OutputStreamInterface* output;
+    QWord skip;
+public:
+    SkipOutputStream(OutputStreamInterface* output, QWord skip);
+    virtual bool write(Byte* buf, QWord size);
+    virtual Byte* reserve(QWord size);
+    virtual void  commit(QWord size);
 };
 
 // file stream
@@ -77,20 +151,49 @@ public:
     virtual QWord getPos();
 };
 
+// buffered file writer - position is kept in memory, data reaches file in large blocks,
+// writes behind the buffer (back-patches) go to file directly
 class FileOutputStream : public OutputStreamInterface {
 protected:
     ofstream* ofs;
     bool created;
+    vector<Byte> buffer;
+    QWord buffer_pos, buffer_used, file_pos;
+    void init();
+    bool writeFile(QWord pos, Byte* buf, QWord size);
+    bool inBuffer(QWord size);
 public:
     FileOutputStream(char* file_name);
     FileOutputStream(ofstream* ofs);
     virtual ~FileOutputStream();
     virtual bool write(Byte* buf, QWord size);
-    virtual void setPos(QWord pos);
-    virtual QWord getPos();
+    virtual Byte* reserve(QWord size);
+    virtual void  commit(QWord size);
+    bool flush();
+};
+
+// prefetch stream - background thread reads blocks of input ahead while consumer works on previous ones
+class PrefetchInputStream : public InputStreamInterface {
+private:
+    struct PrefetchBlock {
+        vector<Byte> data;
+        QWord        size;
+    };
+    InputStreamInterface*    input;
+    WorkQueue<PrefetchBlock> filled_blocks, free_blocks;
+    PrefetchBlock            current;
+    QWord                    current_pos;
+    bool                     finished;
+    thread                   reader;
+    void readAhead();
+public:
+    PrefetchInputStream(InputStreamInterface* input, DWord block_count = PREFETCH_BLOCK_COUNT,
+        QWord block_size = PREFETCH_BLOCK_SIZE);
+    virtual ~PrefetchInputStream();
+    virtual bool read(Byte* buf, QWord size);
 };
 
-// codec stream
+// codec stream - fixed blocks go in records with their size, compact blocks delimit themselves
 class CodecOutputStream : public OutputStreamInterface {
 private:
     InputStreamInterface* input;
@@ -105,12 +208,17 @@ public:
     virtual bool write(Byte* buf, QWord size);
 };
 
+// compact blocks are decoded one by one into memory, reads take any part of decoded data
 class CodecInputStream : public InputStreamInterface {
 private:
     InputStreamInterface* input;
     OutputStreamInterface* output;
     CodecInterface* codec;
     Byte* mem;
+    vector<Byte> block;
+    QWord block_pos, block_size;
+    bool readRecord(Byte* buf, QWord size);
+    bool loadBlock();
 public:
     CodecInputStream(InputStreamInterface* input, OutputStreamInterface* output,
         CodecInterface* codec);
@@ -131,5 +239,24 @@ public:
     FilePartOutputStream(ofstream *ofs, QWord size);
 };
 
+// read size bytes from input and append them to buf
+bool appendStream(InputStreamInterface* input, vector<Byte>& buf, QWord size);
+
+// next size bytes of input - borrowed from stream memory or read into buf, nullptr if input ends before
+Byte* borrowStream(InputStreamInterface* input, Byte* buf, QWord size);
+
+// size bytes of input into buf, also appended to block if given, false if input ends before
+bool readStream(InputStreamInterface* input, Byte* buf, QWord size, vector<Byte>* block = nullptr);
+
+// codec block header - uncompressed size and checksum (nullptr if blocks have none), as QWord with
+// STORED_BLOCK or as flags byte and varint, codecs put sizes of their data behind it,
+// bytes read are appended to block if given, false if input ends before header does
+const DWord BLOCK_HEADER_MAX_SIZE = 1 + VARINT_MAX_SIZE + sizeof(DWord);
+DWord putBlockHeader (Byte* buf, BlockFormat format, Byte flags, QWord size, DWord* checksum);
+bool  readBlockHeader(InputStreamInterface* input, BlockFormat format, Byte* flags, QWord* size, DWord* checksum,
+    vector<Byte>* block = nullptr);
+DWord putBlockSize   (Byte* buf, BlockFormat format, QWord size);
+bool  readBlockSize  (InputStreamInterface* input, BlockFormat format, QWord* size, vector<Byte>* block = nullptr);
+
 }
 #endif
@@ -24,7 +24,11 @@ CodecCallbackInterface::~CodecCallbackInterface() {}
 
 // codec interface
 CodecInterface::CodecInterface() {
-    this->callback = nullptr;
+    this->callback       = nullptr;
+    this->block_checksum = false;
+    this->corrupted      = false;
+    this->block_index    = nullptr;
+    this->block_format   = BF_FIXED;
 }
 
 CodecInterface::~CodecInterface() {};
@@ -32,3 +36,23 @@ CodecInterface::~CodecInterface() {};
 void CodecInterface::setCallback(CodecCallbackInterface* callback) {
     this->callback = callback;
 }
+
+void CodecInterface::setBlockChecksum(bool block_checksum) {
+    this->block_checksum = block_checksum;
+}
+
+void CodecInterface::setBlockIndex(vector<BlockPosition>* block_index) {
+    this->block_index = block_index;
+}
+
+void CodecInterface::setBlockFormat(BlockFormat block_format) {
+    this->block_format = block_format;
+}
+
+BlockFormat CodecInterface::getBlockFormat() {
+    return this->block_format;
+}
+
+bool CodecInterface::isCorrupted() {
+    return this->corrupted;
+}
@@ -8,16 +8,15 @@
 #ifndef SCL_TYPES_H
 #define SCL_TYPES_H
 
-// windows
-#include <windows.h>
-
 // c
 #include <cstdint>
+#include <cstring>
 #include <cassert>
 
 // c++
 #include <fstream>
 #include <string>
+#include <vector>
 #include <iostream>
 
 using namespace std;
@@ -42,10 +41,11 @@ enum CallbackType {
     CLT_ARCHIVE_BEGIN         = 5,
     CLT_COUNTING_FILES        = 6,
     CLT_COUNTING_FILES_FINISH = 7,
-    CLT_STREAM_FINISH         = 8
+    CLT_STREAM_FINISH         = 8,
+    CLT_FILE_CORRUPTED        = 9
 };
 
-enum CallbackAction { CLA_NOACTION = 1, CLA_COMPRESS = 2, CLA_DECOMPRESS = 3 };
+enum CallbackAction { CLA_NOACTION = 1, CLA_COMPRESS = 2, CLA_DECOMPRESS = 3, CLA_VERIFY = 4 };
 
 // codec callback
 struct CodecCallbackInfo {
@@ -57,6 +57,22 @@ struct CodecCallbackInfo {
     int   clock;
 };
 
+// set in uncompressed size of codec block which holds its data as it is
+const QWord STORED_BLOCK = 0x8000000000000000;
+
+// layout of codec block headers - QWord sizes, or flags byte and varint sizes
+enum BlockFormat { BF_FIXED = 0, BF_COMPACT = 1 };
+
+// flags byte of compact block header
+const Byte BLOCK_STORED       = 0x01;  // data is kept as it is
+const Byte BLOCK_EMPTY_STREAM = 0x02;  // shifted by stream number, empty stream has no size and no data
+
+// position of codec block in uncompressed and compressed stream
+struct BlockPosition {
+    QWord in_pos;
+    QWord out_pos;
+};
+
 class CodecCallbackInterface {
 public:
     CodecCallbackInfo info;
@@ -69,11 +85,22 @@ public:
 class CodecInterface {
 protected:
     CodecCallbackInterface* callback;
+    bool block_checksum;    // checksum of uncompressed data stored in every block header
+    bool corrupted;         // set by decoder when block checksum or block framing is wrong
+    BlockFormat block_format;
+    vector<BlockPosition>* block_index; // filled by encoder with start of every block
 public:
     CodecInterface();
     virtual void setCallback(CodecCallbackInterface* callback);
+    virtual void setBlockChecksum(bool block_checksum);
+    virtual void setBlockIndex(vector<BlockPosition>* block_index);
+    virtual void setBlockFormat(BlockFormat block_format);
+    BlockFormat  getBlockFormat();
+    virtual bool isCorrupted();
     virtual QWord compressStream  (InputStreamInterface* input, OutputStreamInterface* output) = 0;
     virtual QWord decompressStream(InputStreamInterface* input, OutputStreamInterface* output) = 0;
+    // copy one encoded block from input without decoding it
+    virtual bool  readBlock(InputStreamInterface* input, vector<Byte>& block) = 0;
     virtual ~CodecInterface() = 0;
 };
 
@@ -7,6 +7,18 @@
 
 #include "Utils.h"
 
+// C
+#include <cmath>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <filesystem>
+#endif
+
 namespace SCL {
 
 // reading/write integers to byte mem
@@ -38,84 +50,355 @@ Word read16From8Buf(Byte* buf) {
     return i;
 }
 
-// file attributes
-DWord getFileAttributes(const wchar_t* f_name) {
-    return GetFileAttributesW(f_name);
+DWord writeVarInt(Byte* buf, QWord i) {
+    DWord size = 0;
+    while (i >= 0x80) {
+        buf[size++] = (Byte)(i | 0x80);
+        i >>= 7;
+    }
+    buf[size++] = (Byte)i;
+    return size;
+}
+
+DWord readVarInt(Byte* buf, Byte* end, QWord* i) {
+    *i = 0;
+    for (DWord size = 0; size < VARINT_MAX_SIZE && buf + size < end; size++) {
+        *i |= (QWord)(buf[size] & 0x7F) << (7 * size);
+        if (!(buf[size] & 0x80)) return size + 1;
+    }
+    return 0;
+}
+
+double entropyBits(QWord* histogram, QWord count) {
+    double bits = 0;
+    for (DWord s = 0; s < 256; s++) {
+        if (histogram[s] > 0) bits += histogram[s] * log2((double)count / histogram[s]);
+    }
+    return bits;
+}
+
+// UTF-8
+string toUTF8(const wstring& text) {
+    string out;
+    out.reserve(text.size());
+    for (size_t n = 0; n < text.size(); n++) {
+        DWord c = (DWord)text[n];
+        // surrogate pair
+        if (sizeof(wchar_t) == 2 && c >= 0xD800 && c < 0xDC00 && n + 1 < text.size() &&
+            (DWord)text[n + 1] >= 0xDC00 && (DWord)text[n + 1] < 0xE000) {
+            c = 0x10000 + ((c - 0xD800) << 10) + ((DWord)text[++n] - 0xDC00);
+        }
+        if (c < 0x80) {
+            out += (char)c;
+        } else if (c < 0x800) {
+            out += (char)(0xC0 | (c >> 6));
+            out += (char)(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            out += (char)(0xE0 | (c >> 12));
+            out += (char)(0x80 | ((c >> 6) & 0x3F));
+            out += (char)(0x80 | (c & 0x3F));
+        } else {
+            out += (char)(0xF0 | (c >> 18));
+            out += (char)(0x80 | ((c >> 12) & 0x3F));
+            out += (char)(0x80 | ((c >> 6) & 0x3F));
+            out += (char)(0x80 | (c & 0x3F));
+        }
+    }
+    return out;
 }
-bool setFileAttributes(const wchar_t* f_name, DWord attr) {
-    return (bool)SetFileAttributesW(f_name, attr);
+
+wstring fromUTF8(const Byte* text, QWord size) {
+    wstring out;
+    out.reserve(size);
+    for (QWord n = 0; n < size; ) {
+        DWord c = text[n++], extra = 0;
+        if      (c >= 0xF0) { c &= 0x07; extra = 3; }
+        else if (c >= 0xE0) { c &= 0x0F; extra = 2; }
+        else if (c >= 0xC0) { c &= 0x1F; extra = 1; }
+        for (; extra > 0 && n < size; extra--) c = (c << 6) | (text[n++] & 0x3F);
+
+        if (sizeof(wchar_t) == 2 && c >= 0x10000) {
+            out += (wchar_t)(0xD800 + ((c - 0x10000) >> 10));
+            out += (wchar_t)(0xDC00 + ((c - 0x10000) & 0x3FF));
+        } else {
+            out += (wchar_t)c;
+        }
+    }
+    return out;
+}
+
+// path conversions of standard library use C locale on other systems and throw for non-ASCII names
+std::filesystem::path toPath(const wstring& file_name) {
+#ifdef _WIN32
+    return std::filesystem::path(file_name);
+#else
+    return std::filesystem::path(toUTF8(file_name));
+#endif
 }
 
-// file time
+wstring fromPath(const std::filesystem::path& file_path) {
+#ifdef _WIN32
+    return file_path.wstring();
+#else
+    const string& name = file_path.native();
+    return fromUTF8((const Byte*)name.data(), name.size());
+#endif
+}
+
+// file time, civil date from days since 1970 (H. Hinnant)
 void FileTime::set(QWord time) {
-    FILETIME file_time;
-    file_time.dwHighDateTime = (time >> 32);
-    file_time.dwLowDateTime  = time & 0xFFFFFFFF;
-    FileTimeToSystemTime(&file_time, &this->sys_time);
+    QWord ms   = time / 10000;
+    QWord days = ms / 86400000;
+    DWord day_ms = (DWord)(ms % 86400000);
+
+    // 1601-01-01 was Monday, 1970-01-01 is 134774 days later
+    long long z   = (long long)days - 134774 + 719468;
+    long long era = (z >= 0 ? z : z - 146096) / 146097;
+    DWord doe = (DWord)(z - era * 146097);
+    DWord yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    DWord doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    DWord mp  = (5 * doy + 2) / 153;
+
+    this->day         = (Word)(doy - (153 * mp + 2) / 5 + 1);
+    this->month       = (Word)(mp < 10 ? mp + 3 : mp - 9);
+    this->year        = (Word)(yoe + era * 400 + (this->month <= 2));
+    this->day_of_week = (Word)((days + 1) % 7);
+    this->hour        = (Word)(day_ms / 3600000);
+    this->minute      = (Word)(day_ms / 60000 % 60);
+    this->second      = (Word)(day_ms / 1000 % 60);
+    this->millisecond = (Word)(day_ms % 1000);
 }
 
 Word FileTime::getYear() {
-    return this->sys_time.wYear;
+    return this->year;
 }
 
 Word FileTime::getMonth() {
-    return this->sys_time.wMonth;
+    return this->month;
 }
 
 Word FileTime::getDayOfWeek() {
-    return this->sys_time.wDayOfWeek;
+    return this->day_of_week;
 }
 
 Word FileTime::getDay() {
-    return this->sys_time.wDay;
+    return this->day;
 }
 
 Word FileTime::getHour() {
-    return this->sys_time.wHour;
+    return this->hour;
 }
 
 Word FileTime::getMinute() {
-    return this->sys_time.wMinute;
+    return this->minute;
 }
 
 Word FileTime::getSecond() {
-    return this->sys_time.wSecond;
+    return this->second;
 }
 
 Word FileTime::getMillisecond() {
-    return this->sys_time.wMilliseconds;
+    return this->millisecond;
+}
+
+#ifdef _WIN32
+static QWord toFileTime(const FILETIME& time) {
+    return QWord(time.dwHighDateTime) << 32 | time.dwLowDateTime;
+}
+#else
+// FILETIME of 1970-01-01
+const QWord UNIX_EPOCH_FILE_TIME = 116444736000000000ULL;
+
+static QWord toFileTime(long long sec, long long nsec) {
+    return (QWord)(sec * 10000000 + nsec / 100) + UNIX_EPOCH_FILE_TIME;
+}
+
+static timespec fromFileTime(QWord time) {
+    long long ticks = (long long)(time - UNIX_EPOCH_FILE_TIME);
+    long long sec   = ticks / 10000000, rest = ticks % 10000000;
+    if (rest < 0) { sec--; rest += 10000000; }
+    timespec ts;
+    ts.tv_sec  = (time_t)sec;
+    ts.tv_nsec = (long)(rest * 100);
+    return ts;
+}
+
+// metadata of open descriptor if name is empty, of named file otherwise
+static bool statFile(int file, const char* name, FileMetadata* metadata) {
+    DWord mode;
+#if defined(__linux__) && defined(STATX_BTIME)
+    // statx gives creation time where file system keeps it
+    struct statx file_stat;
+    int flags = name[0] ? AT_STATX_SYNC_AS_STAT : AT_EMPTY_PATH;
+    if (statx(file, name, flags, STATX_BASIC_STATS | STATX_BTIME, &file_stat) != 0) return false;
+    mode = file_stat.stx_mode;
+    metadata->size              = S_ISDIR(mode) ? 0 : file_stat.stx_size;
+    metadata->access_time       = toFileTime(file_stat.stx_atime.tv_sec, file_stat.stx_atime.tv_nsec);
+    metadata->modification_time = toFileTime(file_stat.stx_mtime.tv_sec, file_stat.stx_mtime.tv_nsec);
+    metadata->creation_time     = (file_stat.stx_mask & STATX_BTIME) ?
+                                  toFileTime(file_stat.stx_btime.tv_sec, file_stat.stx_btime.tv_nsec) :
+                                  metadata->modification_time;
+#else
+    struct stat file_stat;
+    if ((name[0] ? stat(name, &file_stat) : fstat(file, &file_stat)) != 0) return false;
+    mode = file_stat.st_mode;
+    metadata->size              = S_ISDIR(mode) ? 0 : file_stat.st_size;
+    metadata->access_time       = toFileTime(file_stat.st_atime, 0);
+    metadata->modification_time = toFileTime(file_stat.st_mtime, 0);
+    metadata->creation_time     = metadata->modification_time;
+#endif
+    metadata->attributes = ATTRIBUTE_UNIX_MODE | mode << 16;
+    if (S_ISDIR(mode))        metadata->attributes |= ATTRIBUTE_DIRECTORY;
+    if (!(mode & S_IWUSR))    metadata->attributes |= ATTRIBUTE_READONLY;
+    return true;
+}
+
+// times and attributes, attributes from Windows only tell if file is read-only
+bool setFileMetadata(int file, FileMetadata& metadata) {
+    timespec times[2] = { fromFileTime(metadata.access_time), fromFileTime(metadata.modification_time) };
+    bool ok = futimens(file, times) == 0;
+
+    if (metadata.attributes & ATTRIBUTE_UNIX_MODE) {
+        ok = fchmod(file, (mode_t)(metadata.attributes >> 16) & 07777) == 0 && ok;
+    } else if (metadata.attributes & ATTRIBUTE_READONLY) {
+        struct stat file_stat;
+        ok = fstat(file, &file_stat) == 0 && fchmod(file, file_stat.st_mode & 07555) == 0 && ok;
+    }
+    return ok;
+}
+#endif
+
+bool getFileMetadata(const wchar_t* f_name, FileMetadata* metadata) {
+    memset(metadata, 0, sizeof(FileMetadata));
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if (!GetFileAttributesExW(f_name, GetFileExInfoStandard, &info)) return false;
+    metadata->attributes        = info.dwFileAttributes;
+    metadata->creation_time     = toFileTime(info.ftCreationTime);
+    metadata->access_time       = toFileTime(info.ftLastAccessTime);
+    metadata->modification_time = toFileTime(info.ftLastWriteTime);
+    bool dir = (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    metadata->size = dir ? 0 : QWord(info.nFileSizeHigh) << 32 | info.nFileSizeLow;
+    return true;
+#else
+    return statFile(AT_FDCWD, toPath(f_name).c_str(), metadata);
+#endif
+}
+
+// file handle
+FileHandle::FileHandle() {
+#ifdef _WIN32
+    file = INVALID_HANDLE_VALUE;
+#else
+    file = -1;
+#endif
 }
 
-void getFileTime(const wchar_t* f_name, QWord* fcr, QWord* fla, QWord* lwr, bool dir) {
-    FILETIME ft1, ft2, ft3;
-    HANDLE hf = CreateFileW(f_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
-        (dir ? (FILE_ATTRIBUTE_DIRECTORY | FILE_FLAG_BACKUP_SEMANTICS) : FILE_ATTRIBUTE_NORMAL), NULL);
-    GetFileTime(hf, &ft1, &ft2, &ft3);
-    CloseHandle(hf);
-    *fcr = QWord(ft1.dwHighDateTime) << 32 | ft1.dwLowDateTime;
-    *fla = QWord(ft2.dwHighDateTime) << 32 | ft2.dwLowDateTime;
-    *lwr = QWord(ft3.dwHighDateTime) << 32 | ft3.dwLowDateTime;
+FileHandle::~FileHandle() {
+    close();
 }
 
-void setFileTime(const wchar_t* f_name, QWord fcr, QWord fla, QWord lwr, bool dir) {
-    FILETIME ft1, ft2, ft3;
-    ft1.dwHighDateTime = (fcr >> 32); ft1.dwLowDateTime = fcr & 0xFFFFFFFF;
-    ft2.dwHighDateTime = (fla >> 32); ft2.dwLowDateTime = fla & 0xFFFFFFFF;
-    ft3.dwHighDateTime = (lwr >> 32); ft3.dwLowDateTime = lwr & 0xFFFFFFFF;
-    HANDLE hf = CreateFileW(f_name, GENERIC_ALL, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
-        (dir ? (FILE_FLAG_BACKUP_SEMANTICS | FILE_ATTRIBUTE_DIRECTORY) : FILE_ATTRIBUTE_NORMAL), NULL);
-    SetFileTime(hf, &ft1, &ft2, &ft3);
-    CloseHandle(hf);
+bool FileHandle::open(const wchar_t* f_name, bool write) {
+    close();
+#ifdef _WIN32
+    DWORD access = FILE_READ_ATTRIBUTES | (write ? FILE_WRITE_ATTRIBUTES : 0);
+    file = CreateFileW(f_name, access, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+                       FILE_FLAG_BACKUP_SEMANTICS, NULL);
+#else
+    // reading metadata needs no access to data, setting it needs descriptor open for reading
+    int flags = O_RDONLY | O_NONBLOCK | O_CLOEXEC;
+#ifdef O_PATH
+    if (!write) flags = O_PATH | O_CLOEXEC;
+#endif
+    file = ::open(toPath(f_name).c_str(), flags);
+#endif
+    return isOpen();
 }
 
-void stringToWstring(string& in, wstring* out) {
-    if (in.length() == 0) return;
-    wchar_t* wstr = new wchar_t[MAX_PATH];
-    size_t converted(0);
-    mbstowcs_s(&converted, wstr, MAX_PATH, in.c_str(), in.length());
-    *out = wstr;
+bool FileHandle::create(const wchar_t* f_name) {
+    close();
+#ifdef _WIN32
+    file = CreateFileW(f_name, GENERIC_WRITE | FILE_READ_ATTRIBUTES | FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ, NULL,
+                       CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+#else
+    file = ::open(toPath(f_name).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+#endif
+    return isOpen();
+}
+
+// whole buffer or failure
+bool FileHandle::write(Byte* buf, QWord size) {
+    while (size > 0) {
+        DWord part = (DWord)min(size, (QWord)0x40000000);
+#ifdef _WIN32
+        DWORD written = 0;
+        if (!WriteFile(file, buf, part, &written, NULL) || written == 0) return false;
+#else
+        ssize_t written = ::write(file, buf, part);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+#endif
+        buf  += written;
+        size -= written;
+    }
+    return true;
+}
+
+void FileHandle::close() {
+#ifdef _WIN32
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (file >= 0) ::close(file);
+    file = -1;
+#endif
+}
+
+bool FileHandle::isOpen() {
+#ifdef _WIN32
+    return file != INVALID_HANDLE_VALUE;
+#else
+    return file >= 0;
+#endif
+}
+
+bool FileHandle::getMetadata(FileMetadata* metadata) {
+    memset(metadata, 0, sizeof(FileMetadata));
+    if (!isOpen()) return false;
+#ifdef _WIN32
+    BY_HANDLE_FILE_INFORMATION info;
+    if (!GetFileInformationByHandle(file, &info)) return false;
+    metadata->attributes        = info.dwFileAttributes;
+    metadata->creation_time     = toFileTime(info.ftCreationTime);
+    metadata->access_time       = toFileTime(info.ftLastAccessTime);
+    metadata->modification_time = toFileTime(info.ftLastWriteTime);
+    bool dir = (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    metadata->size = dir ? 0 : QWord(info.nFileSizeHigh) << 32 | info.nFileSizeLow;
+    return true;
+#else
+    return statFile(file, "", metadata);
+#endif
+}
+
+// times and attributes, creation time is set only where system allows it
+bool FileHandle::setMetadata(FileMetadata& metadata) {
+    if (!isOpen()) return false;
+#ifdef _WIN32
+    FILE_BASIC_INFO info;
+    memset(&info, 0, sizeof(info));
+    info.CreationTime.QuadPart   = metadata.creation_time;
+    info.LastAccessTime.QuadPart = metadata.access_time;
+    info.LastWriteTime.QuadPart  = metadata.modification_time;
 
-    delete[] wstr;
+    // mode of other systems is not Windows attribute, 0 would keep attributes unchanged
+    DWord attributes = metadata.attributes;
+    if (attributes & ATTRIBUTE_UNIX_MODE) attributes &= ATTRIBUTE_READONLY | ATTRIBUTE_DIRECTORY;
+    attributes &= ~ATTRIBUTE_DIRECTORY;
+    info.FileAttributes = attributes ? attributes : FILE_ATTRIBUTE_NORMAL;
+    return SetFileInformationByHandle(file, FileBasicInfo, &info, sizeof(info)) != 0;
+#else
+    return setFileMetadata(file, metadata);
+#endif
 }
 
 QWord fileSize(ifstream& ifile) {
@@ -126,4 +409,111 @@ QWord fileSize(ifstream& ifile) {
     return in_file_size;
 }
 
-}
\ No newline at end of file
+// memory mapped file
+MappedFile::MappedFile() {
+    data = nullptr;
+    size = 0;
+#ifdef _WIN32
+    file    = INVALID_HANDLE_VALUE;
+    mapping = NULL;
+#else
+    file    = -1;
+#endif
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const wchar_t* f_name) {
+    close();
+#ifdef _WIN32
+    file = CreateFileW(f_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) { close(); return false; }
+    size = (QWord)file_size.QuadPart;
+
+    // empty file can not be mapped
+    if (size == 0) return true;
+    mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) { close(); return false; }
+    data = (Byte*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    file = ::open(toPath(f_name).c_str(), O_RDONLY);
+    if (file < 0) return false;
+    struct stat file_stat;
+    if (fstat(file, &file_stat) != 0) { close(); return false; }
+    size = (QWord)file_stat.st_size;
+
+    // empty file can not be mapped
+    if (size == 0) return true;
+    void* view = mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0);
+    data = view == MAP_FAILED ? nullptr : (Byte*)view;
+#endif
+    if (!data) { close(); return false; }
+    return true;
+}
+
+// mapping will be read from begin to end, hint for kernel read-ahead (Windows views read ahead on their own)
+void MappedFile::adviseSequential() {
+#ifndef _WIN32
+    if (data) madvise(data, size, MADV_SEQUENTIAL);
+#endif
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (data)                         UnmapViewOfFile(data);
+    if (mapping != NULL)              CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    mapping = NULL;
+    file    = INVALID_HANDLE_VALUE;
+#else
+    if (data)      munmap(data, size);
+    if (file >= 0) ::close(file);
+    file = -1;
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+bool MappedFile::isOpen() {
+#ifdef _WIN32
+    return file != INVALID_HANDLE_VALUE;
+#else
+    return file >= 0;
+#endif
+}
+
+Byte* MappedFile::getData() {
+    return data;
+}
+
+QWord MappedFile::getSize() {
+    return size;
+}
+
+bool matchPattern(const wchar_t* pattern, const wchar_t* name) {
+    const wchar_t *star = nullptr, *star_name = nullptr;
+    while (*name) {
+        if (*pattern == L'?' || *pattern == *name) {
+            pattern++;
+            name++;
+        } else if (*pattern == L'*') {
+            // remember last star, try to match empty sequence first
+            star      = pattern++;
+            star_name = name;
+        } else if (star) {
+            // extend sequence matched by last star
+            pattern = star + 1;
+            name    = ++star_name;
+        } else {
+            return false;
+        }
+    }
+    while (*pattern == L'*') pattern++;
+    return *pattern == 0;
+}
+
+}
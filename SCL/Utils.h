@@ -16,9 +16,15 @@
 #include <fstream>
 #include <cstdlib>
 #include <string>
+#include <filesystem>
 
 // c
-//#include <ctime>
+#include <ctime>
+
+#ifdef _WIN32
+// Windows
+#include <windows.h>
+#endif
 
 // Archive
 #include "Types.h"
@@ -36,14 +42,69 @@ DWord write16To8Buf (Byte *buf, Word  i);
 DWord read32From8Buf(Byte *buf);
 Word  read16From8Buf(Byte *buf);
 
-// file attributes
-DWord getFileAttributes (const wchar_t *f_name);
-bool  setFileAttributes (const wchar_t *f_name, DWord attr);
+// variable length integers, 7 bits per byte, at most VARINT_MAX_SIZE bytes
+const DWord VARINT_MAX_SIZE = 10;
+DWord writeVarInt(Byte *buf, QWord i);
+DWord readVarInt (Byte *buf, Byte *end, QWord *i);  // 0 if value does not end before end
+
+// order-0 entropy of counted bytes in bits, no order-0 coding of them is shorter
+double entropyBits(QWord *histogram, QWord count);
+
+// UTF-8 conversion, wchar_t holds UTF-16 on Windows and UTF-32 elsewhere
+string  toUTF8  (const wstring& text);
+wstring fromUTF8(const Byte *text, QWord size);
+
+// file names are wide strings in library, native paths hold UTF-8 names on other systems than Windows
+std::filesystem::path toPath  (const wstring& file_name);
+wstring               fromPath(const std::filesystem::path& file_path);
+
+// file attributes are stored as on Windows, other systems add their mode in high word (as 7-Zip does)
+const DWord ATTRIBUTE_READONLY  = 0x01;
+const DWord ATTRIBUTE_DIRECTORY = 0x10;
+const DWord ATTRIBUTE_UNIX_MODE = 0x8000;
+
+// file times are stored in 100 ns units since 1601 (Windows FILETIME) on all systems
+struct FileMetadata {
+    QWord size;
+    DWord attributes;
+    QWord creation_time;
+    QWord access_time;
+    QWord modification_time;
+};
+
+// metadata by name, one system call without opening file
+bool getFileMetadata(const wchar_t *f_name, FileMetadata *metadata);
+#ifndef _WIN32
+bool setFileMetadata(int file, FileMetadata &metadata);
+#endif
+
+// file or directory opened for its metadata, or file created for writing, metadata is read and set through handle
+class FileHandle {
+private:
+#ifdef _WIN32
+    HANDLE file;
+#else
+    int    file;
+#endif
+    FileHandle(const FileHandle&)            = delete;
+    FileHandle& operator=(const FileHandle&) = delete;
+public:
+    FileHandle();
+    ~FileHandle();
+    bool open(const wchar_t *f_name, bool write = false);  // write - metadata will be set
+    bool create(const wchar_t *f_name);                    // new or truncated file for writing
+    bool write(Byte *buf, QWord size);
+    void close();
+    bool isOpen();
+    bool getMetadata(FileMetadata *metadata);
+    bool setMetadata(FileMetadata &metadata);
+};
 
-// file time
+// file time in UTC
 class FileTime {
 private:
-    SYSTEMTIME sys_time;
+    Word year, month, day, day_of_week;
+    Word hour, minute, second, millisecond;
 
 public:
     void set(QWord time);
@@ -57,12 +118,36 @@ public:
     Word getMillisecond();
 };
 
-void getFileTime(const wchar_t *f_name, QWord *fcr, QWord *fla, QWord *lwr, bool dir = false);
-void setFileTime(const wchar_t *f_name, QWord  fcr, QWord  fla, QWord  lwr, bool dir = false);
-
 // file size
 QWord fileSize(ifstream& ifile);
 
+// read-only memory mapping of whole file, shared by threads reading archive
+class MappedFile {
+private:
+    Byte* data;
+    QWord size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int    file;
+#endif
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+public:
+    MappedFile();
+    ~MappedFile();
+    bool  open(const wchar_t *f_name);
+    void  close();
+    bool  isOpen();
+    void  adviseSequential();
+    Byte* getData();
+    QWord getSize();
+};
+
+// wildcard matching, '*' - any sequence of characters, '?' - any single character
+bool matchPattern(const wchar_t* pattern, const wchar_t* name);
+
 } // namespace
 
 #endif // SCL_UTILS_H
@@ -0,0 +1,87 @@
+////////////////////////////////////////////
+// Small Compression Library              //
+// author: Mariusz Ziach                  //
+// www   : http://ziach.pl/               //
+// date  : 2020                           //
+////////////////////////////////////////////
+
+#ifndef SCL_WORKQUEUE_H
+#define SCL_WORKQUEUE_H
+
+// C++
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+namespace SCL {
+
+// items waiting in queue, sampled by every push
+struct QueueStats {
+    size_t pushed;
+    size_t max_depth;
+    size_t depth_sum;   // average depth is depth_sum / pushed
+};
+
+// bounded blocking queue shared by producer and worker threads
+template <class T>
+class WorkQueue {
+private:
+    std::deque<T>           items;
+    std::mutex              queue_mutex;
+    std::condition_variable not_empty, not_full;
+    size_t                  capacity;
+    bool                    closed;
+    QueueStats              stats;
+public:
+    WorkQueue(size_t capacity) {
+        this->capacity = capacity ? capacity : 1;
+        this->closed   = false;
+        this->stats    = { 0, 0, 0 };
+    }
+
+    // blocks while queue is full, returns false if queue was closed
+    bool push(T&& item) {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        not_full.wait(lock, [this] { return items.size() < capacity || closed; });
+        if (closed) return false;
+        items.push_back(std::move(item));
+        stats.pushed++;
+        stats.depth_sum += items.size();
+        if (items.size() > stats.max_depth) stats.max_depth = items.size();
+        not_empty.notify_one();
+        return true;
+    }
+
+    // blocks while queue is empty, returns false when closed and drained
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        not_empty.wait(lock, [this] { return !items.empty() || closed; });
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    // no more items will be pushed
+    void close() {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        closed = true;
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        return items.size();
+    }
+
+    QueueStats getStats() {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        return stats;
+    }
+};
+
+} // namespace
+
+#endif // SCL_WORKQUEUE_H